@@ -18,11 +18,17 @@
 
 #include "meminstrument/pass/ITarget.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 
+#include <map>
+
 namespace meminstrument {
 
 class GlobalConfig;
@@ -115,6 +121,36 @@ public:
   /// checks similar to checks.
   virtual bool invariantsAreChecks() const = 0;
 
+  /// Insert a conditional branch before Location that jumps to a block calling
+  /// the fail function if FailCond holds. All such branches of a function share
+  /// a single failing block, and the branch is annotated as unlikely taken.
+  /// Location must not be a phi. With -mi-branchless-checks, a load or store
+  /// at Location that dereferences DerefPtr (the pointer checked by a
+  /// dereference check, nullptr for all other checks) instead accesses a
+  /// faulting guard address if FailCond holds.
+  /// With -mi-deferred-checks, the branch for a check at an instruction that
+  /// does not write memory is moved down to the next side effect that escapes
+  /// (a call, a return, a volatile load, or a store to memory that may be
+  /// visible outside the function) or the end of the block, and all failure
+  /// conditions that meet there share one branch. These branches are inserted
+  /// by materializeDeferredChecks.
+  /// Optimizations use this for the checks they place themselves.
+  void insertFailBranch(llvm::Value *FailCond, llvm::Instruction *Location,
+                        llvm::Value *DerefPtr = nullptr) const;
+
+  /// Returns true iff inline check failures are deferred, see
+  /// insertFailBranch.
+  static bool hasDeferredChecks();
+
+  /// Insert the fail branches for the deferred check failures of the
+  /// function. Has to be called after all checks of the function are inserted.
+  void materializeDeferredChecks(llvm::Function &) const;
+
+  /// Estimate the run-time cost of one execution of the check for the given
+  /// target, relative to the cost of a single memory access. Optimizations use
+  /// this to trade checks for run-time overhead.
+  virtual double getExpectedCheckCost(const ITarget &) const { return 1.0; }
+
   virtual ~InstrumentationMechanism() {}
 
   InstrumentationMechanism(GlobalConfig &cfg) : globalConfig(cfg) {}
@@ -125,6 +161,17 @@ public:
   static llvm::GlobalVariable *insertStringLiteral(llvm::Module &,
                                                    llvm::StringRef);
 
+  /// Register a new static constructor with the given name and return the
+  /// block to insert its code into, in front of the block's terminator.
+  static llvm::BasicBlock *insertSetupCtor(llvm::Module &, llvm::StringRef);
+
+  /// Like insertSetupCtor, but the returned block only runs if the
+  /// environment variable \p EnvVar is set. Its value is stored in
+  /// \p EnvValue.
+  static llvm::BasicBlock *insertSetupCtor(llvm::Module &, llvm::StringRef,
+                                           llvm::StringRef EnvVar,
+                                           llvm::Value *&EnvValue);
+
 protected:
   GlobalConfig &globalConfig;
   llvm::FunctionCallee failFunction = nullptr;
@@ -132,6 +179,45 @@ protected:
   llvm::FunctionCallee warningFunction = nullptr;
 
 private:
+  /// Shared failing blocks per function, see insertFailBranch.
+  mutable std::map<llvm::Function *, llvm::BasicBlock *> FailBlocks;
+
+  /// Deferred failure conditions per function and position of their fail
+  /// branch, see insertFailBranch.
+  mutable std::map<
+      llvm::Function *,
+      llvm::MapVector<llvm::Instruction *, llvm::SmallVector<llvm::Value *, 4>>>
+      DeferredFailConds;
+
+  /// Whether allocas of the current function may be captured, computed on
+  /// demand for deferring checks past stores.
+  mutable llvm::DenseMap<const llvm::AllocaInst *, bool> CapturedAllocas;
+
+  /// Returns true iff the effects of I may be observed outside of the current
+  /// function, i.e., a deferred check failure has to be reported before I.
+  bool isEscapingSideEffect(const llvm::Instruction &I) const;
+
+  /// Insert the fail branch for FailCond right before Location.
+  void insertFailBranchAt(llvm::Value *FailCond,
+                          llvm::Instruction *Location) const;
+
+  /// Knowledge about the library functions of the target, used to identify
+  /// allocation functions. Created on first use.
+  mutable std::unique_ptr<llvm::TargetLibraryInfoImpl> TLII;
+
+  /// Compute the bounds of globals and allocas of compile-time known size,
+  /// see insertKnownBounds.
+  bool insertStaticBounds(llvm::Value *Instrumentee,
+                          llvm::Instruction *Location, llvm::Type *PtrTy,
+                          llvm::Value *&Lower, llvm::Value *&Upper) const;
+
+  /// Compute the bounds of the result of a call to an allocation function
+  /// from the size arguments of the call, see insertKnownBounds.
+  bool insertAllocationSiteBounds(llvm::Value *Instrumentee,
+                                  llvm::Instruction *Location,
+                                  llvm::Type *PtrTy, llvm::Value *&Lower,
+                                  llvm::Value *&Upper) const;
+
   /// Base case for the implementation of the insertFunDecl helper function.
   static llvm::FunctionCallee insertFunDecl_impl(std::vector<llvm::Type *> &Vec,
                                                  llvm::Module &M,
@@ -182,6 +268,30 @@ protected:
     return insertFunDecl_impl(Vec, M, Name, AList, RetTy, args...);
   }
 
+  /// Determine whether the bounds of Instrumentee are available as values at
+  /// Location without a run-time lookup. This is the case for globals and
+  /// allocas of compile-time known size (with -mi-static-witnesses) and for
+  /// results of allocation functions whose size is an SSA value (with
+  /// -mi-allocation-site-witnesses). If so, pointers of type PtrTy to the
+  /// first byte of the object and one past its last byte are inserted at
+  /// Location, stored in Lower and Upper, and true is returned.
+  bool insertKnownBounds(llvm::Value *Instrumentee, llvm::Instruction *Location,
+                         llvm::Type *PtrTy, llvm::Value *&Lower,
+                         llvm::Value *&Upper) const;
+
+  /// Insert a check before Location that fails if the Size bytes accessed at
+  /// Ptr are not within [Lower, Upper).
+  void insertKnownBoundsDerefCheck(llvm::IRBuilder<> &, llvm::Value *Lower,
+                                   llvm::Value *Upper, llvm::Value *Ptr,
+                                   llvm::Value *Size,
+                                   llvm::Instruction *Location) const;
+
+  /// Insert a check before Location that fails if Ptr is not within
+  /// [Lower, Upper], i.e., one-past-the-end pointers are allowed.
+  void insertKnownBoundsInboundsCheck(llvm::IRBuilder<> &, llvm::Value *Lower,
+                                      llvm::Value *Upper, llvm::Value *Ptr,
+                                      llvm::Instruction *Location) const;
+
   /// Several helper functions for inserting new instructions.
   static llvm::Instruction *insertCall(llvm::IRBuilder<> &B,
                                        llvm::FunctionCallee Fun,
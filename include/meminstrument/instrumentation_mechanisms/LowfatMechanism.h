@@ -55,12 +55,22 @@ struct LowfatWitness : public Witness {
 
   bool hasBoundsMaterialized(void) const;
 
+  /// Returns true iff the bounds were known when creating the witness, such
+  /// that checks can compare against them without computing the lowfat region
+  /// size.
+  bool hasKnownBounds(void) const;
+
   LowfatWitness(llvm::Value *WitnessValue, llvm::Instruction *Location);
 
+  LowfatWitness(llvm::Value *WitnessValue, llvm::Value *LowerBound,
+                llvm::Value *UpperBound, llvm::Instruction *Location);
+
   static bool classof(const Witness *W) { return W->getKind() == WK_Lowfat; }
 
 private:
   llvm::Instruction *Location;
+
+  bool KnownBounds = false;
 };
 
 class LowfatMechanism : public InstrumentationMechanism {
@@ -95,6 +105,8 @@ public:
 
   virtual bool invariantsAreChecks() const override;
 
+  virtual double getExpectedCheckCost(const ITarget &) const override;
+
 private:
   llvm::FunctionCallee CheckDerefFunction = nullptr;
   llvm::FunctionCallee CheckOOBFunction = nullptr;
@@ -110,8 +122,21 @@ private:
   llvm::Type *PtrArgType = nullptr;
   llvm::Type *SizeType = nullptr;
 
+  /// Constant copies of the run-time region tables, only present if checks are
+  /// generated inline.
+  llvm::GlobalVariable *RegionSizesTable = nullptr;
+  llvm::GlobalVariable *RegionMasksTable = nullptr;
+
   void initTypes(llvm::LLVMContext &);
   void insertFunctionDeclarations(llvm::Module &);
+  void insertRegionTables(llvm::Module &);
+  auto insertRegionTableLookup(llvm::IRBuilder<> &, llvm::GlobalVariable *table,
+                               llvm::Value *ptrInt) const -> llvm::Value *;
+  auto insertInlineBaseCalculation(llvm::IRBuilder<> &, llvm::Value *ptr) const
+      -> llvm::Value *;
+  void insertInlineDerefCheck(llvm::IRBuilder<> &, llvm::Value *witness,
+                              llvm::Value *ptr, llvm::Value *size,
+                              llvm::Instruction *location) const;
   void prepareGlobals(llvm::Module &) const;
   bool globalCannotBeInstrumented(const llvm::GlobalVariable &) const;
   void instrumentGlobal(llvm::GlobalVariable &) const;
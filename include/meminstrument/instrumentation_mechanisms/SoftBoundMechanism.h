@@ -66,6 +66,8 @@ public:
 
   virtual bool invariantsAreChecks() const override;
 
+  virtual auto getExpectedCheckCost(const ITarget &) const -> double override;
+
 private:
   /// Handles for SoftBound run-time function declarations for which calls are
   /// inserted during instrumentation
@@ -50,12 +50,21 @@ struct SplayWitness : public Witness {
 
   bool hasBoundsMaterialized(void) const;
 
+  /// Returns true iff the bounds were known when creating the witness, such
+  /// that checks can compare against them without querying the splay tree.
+  bool hasKnownBounds(void) const;
+
   SplayWitness(llvm::Value *WitnessValue, llvm::Instruction *Location);
 
+  SplayWitness(llvm::Value *WitnessValue, llvm::Value *LowerBound,
+               llvm::Value *UpperBound, llvm::Instruction *Location);
+
   static bool classof(const Witness *W) { return W->getKind() == WK_Splay; }
 
 private:
   llvm::Instruction *Location;
+
+  bool KnownBounds = false;
 };
 
 class SplayMechanism : public InstrumentationMechanism {
@@ -93,6 +102,8 @@ public:
 
   virtual bool invariantsAreChecks() const override;
 
+  virtual double getExpectedCheckCost(const ITarget &) const override;
+
 protected:
   llvm::Type *WitnessType = nullptr;
   llvm::Type *PtrArgType = nullptr;
@@ -64,6 +64,11 @@ private:
 
   void insertStatsFunctions(RunTimeHandles &) const;
 
+  /// Add the given function attributes to fun and return it.
+  auto addFunctionAttributes(llvm::Function *fun,
+                             llvm::ArrayRef<llvm::Attribute::AttrKind>) const
+      -> llvm::Function *;
+
   template <typename... ArgsTy>
   auto createAndInsertPrototype(const llvm::StringRef &name,
                                 llvm::Type *retType, ArgsTy... args) const
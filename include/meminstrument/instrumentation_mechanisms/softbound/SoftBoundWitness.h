@@ -29,18 +29,24 @@ class SoftBoundWitness : public Witness {
 
 public:
   SoftBoundWitness(llvm::Value *lowerBound, llvm::Value *upperBound,
-                   llvm::Value *ptr);
+                   llvm::Value *ptr, bool knownBounds = false);
 
   virtual auto getLowerBound() const -> llvm::Value * override;
 
   virtual auto getUpperBound() const -> llvm::Value * override;
 
+  /// Returns true iff the bounds were known when creating the witness (e.g.,
+  /// for globals or allocation sites), such that checks can compare against
+  /// them inline.
+  auto hasKnownBounds() const -> bool;
+
   static bool classof(const Witness *W);
 
 private:
   llvm::Value *lowerBound = nullptr;
   llvm::Value *upperBound = nullptr;
   llvm::Value *ptr = nullptr;
+  bool knownBounds = false;
 };
 
 class SoftBoundVarArgWitness : public Witness {
@@ -0,0 +1,54 @@
+//===- meminstrument/AvailableChecksPass.h - Available Checks ---*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// A check is redundant if, on every path to it, a check that covers the same
+/// or more memory has already been executed. Dominance only captures the case
+/// where a single check precedes it on all paths. This optimization computes
+/// the checks available at each block with a forward must-dataflow analysis,
+/// and thereby also removes checks that are preceded by a covering check in
+/// each branch of a preceding conditional.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_OPTIMIZATION_AVAILABLECHECKSPASS_H
+#define MEMINSTRUMENT_OPTIMIZATION_AVAILABLECHECKSPASS_H
+
+#include "meminstrument/optimizations/OptimizationInterface.h"
+#include "meminstrument/pass/ITarget.h"
+
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace meminstrument {
+
+class AvailableChecksPass : public llvm::ModulePass,
+                            public OptimizationInterface {
+public:
+  // ModulePass methods
+
+  /// Identification
+  static char ID;
+
+  /// Default constructor to initialize the module pass interface
+  AvailableChecksPass();
+
+  virtual bool runOnModule(llvm::Module &) override;
+
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &) const override;
+
+  virtual void print(llvm::raw_ostream &, const llvm::Module *) const override;
+
+  // OptimizationInterface methods
+
+  virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
+                                         llvm::Function &) override;
+};
+
+} // namespace meminstrument
+
+#endif
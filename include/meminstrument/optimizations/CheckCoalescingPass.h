@@ -0,0 +1,68 @@
+//===- meminstrument/CheckCoalescingPass.h - Coalesce Checks ----*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Accesses to several fields of the same struct produce one check per field
+/// address, although all of them are derived from the same base pointer with
+/// constant offsets. If these accesses are executed one after the other, it
+/// suffices to check the range from the lowest to the highest accessed byte
+/// once, before the first access. This optimization replaces the targets for
+/// such accesses by a single, wider check target.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_OPTIMIZATION_CHECKCOALESCINGPASS_H
+#define MEMINSTRUMENT_OPTIMIZATION_CHECKCOALESCINGPASS_H
+
+#include "meminstrument/optimizations/OptimizationInterface.h"
+#include "meminstrument/pass/ITarget.h"
+
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace meminstrument {
+
+class CheckCoalescingPass : public llvm::ModulePass,
+                            public OptimizationInterface {
+public:
+  // ModulePass methods
+
+  /// Identification
+  static char ID;
+
+  /// Default constructor to initialize the module pass interface
+  CheckCoalescingPass();
+
+  virtual bool runOnModule(llvm::Module &) override;
+
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &) const override;
+
+  virtual void print(llvm::raw_ostream &, const llvm::Module *) const override;
+
+  // OptimizationInterface methods
+
+  virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
+                                         llvm::Function &) override;
+
+private:
+  /// Checks for accesses relative to the same base pointer that are executed
+  /// one after the other. The first check is the leader of the group.
+  struct CheckGroup {
+    llvm::SmallVector<ConstSizeCheckIT *, 4> members;
+    llvm::SmallVector<int64_t, 4> offsets;
+  };
+
+  /// Replace the checks of the group by a single check at the location of its
+  /// leader, and add the new target to \p targets.
+  void coalesce(const CheckGroup &, llvm::Value *base,
+                const llvm::DominatorTree &, ITargetVector &targets) const;
+};
+
+} // namespace meminstrument
+
+#endif
@@ -21,6 +21,7 @@
 #include "meminstrument/optimizations/OptimizationInterface.h"
 #include "meminstrument/pass/ITarget.h"
 
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
 
@@ -48,10 +49,18 @@ public:
   virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
                                          llvm::Function &) override;
 
-private:
   /// Check if the target \p one accesses the same or strictly more memory than
-  /// \p other. Returns true if this is the case.
-  bool subsumes(const ITarget &one, const ITarget &other) const;
+  /// \p other. Returns true if this is the case. Instrumentees derived from
+  /// the same base pointer with constant offsets are compared by the accessed
+  /// range, variable access sizes are compared with ScalarEvolution.
+  static bool subsumes(const ITarget &one, const ITarget &other,
+                       llvm::ScalarEvolution &);
+
+private:
+  /// Returns the access size of a check target with a constant or variable
+  /// size as 64 bit SCEV, or nullptr for other targets.
+  static auto getAccessSizeSCEV(const ITarget &, llvm::ScalarEvolution &)
+      -> const llvm::SCEV *;
 };
 
 } // namespace meminstrument
@@ -0,0 +1,79 @@
+//===- meminstrument/EarlyArgumentCheckPass.h - Early Checks ----*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Accesses through pointers that are available at the entry of a function
+/// (arguments, globals, and constant offsets from them) can be checked at the
+/// entry if the access is anticipated there, i.e., if every execution of the
+/// function reaches it. Checks of different offsets from the same pointer are
+/// then combined into a single check of the whole accessed range. This
+/// optimization replaces the targets of such accesses by check targets at the
+/// function entry.
+///
+/// An access is anticipated at the function entry if its location
+/// post-dominates the entry, and no instruction on the way might prevent
+/// reaching it (e.g., calls that might not return) or change the bounds of the
+/// accessed object (calls that might free memory). Code paths containing a
+/// loop are rejected, as the loop might not terminate.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_OPTIMIZATION_EARLYARGUMENTCHECKPASS_H
+#define MEMINSTRUMENT_OPTIMIZATION_EARLYARGUMENTCHECKPASS_H
+
+#include "meminstrument/optimizations/OptimizationInterface.h"
+#include "meminstrument/pass/ITarget.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace meminstrument {
+
+class EarlyArgumentCheckPass : public llvm::ModulePass,
+                               public OptimizationInterface {
+public:
+  // ModulePass methods
+
+  /// Identification
+  static char ID;
+
+  /// Default constructor to initialize the module pass interface
+  EarlyArgumentCheckPass();
+
+  virtual bool runOnModule(llvm::Module &) override;
+
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &) const override;
+
+  virtual void print(llvm::raw_ostream &, const llvm::Module *) const override;
+
+  // OptimizationInterface methods
+
+  virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
+                                         llvm::Function &) override;
+
+private:
+  /// Check whether \p location is reached in every execution of its function
+  /// without passing an instruction that is not safe to move a check over.
+  bool isAnticipatedAtEntry(llvm::Instruction *location,
+                            const llvm::PostDominatorTree &);
+
+  /// Check whether the blocks that execute before \p block, starting from the
+  /// function entry, form an acyclic region of safe instructions.
+  bool isSafeRegionBefore(llvm::BasicBlock *block) const;
+
+  /// Returns true iff a check can be moved from after \p inst to before it.
+  static bool isSafeToMoveCheckOver(const llvm::Instruction &inst);
+
+  /// Cached results of isSafeRegionBefore for the current function.
+  llvm::DenseMap<const llvm::BasicBlock *, bool> safeRegions;
+};
+
+} // namespace meminstrument
+
+#endif
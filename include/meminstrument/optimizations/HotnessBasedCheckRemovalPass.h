@@ -9,12 +9,20 @@
 /// This pass can filter out check targets based on various criteria: at random
 /// or the x percent hottest or coolest checks. For the filtering of the hottest
 /// or coolest checks, the frequency data has to be collected in a separate run
-/// by RuntimeStatMechanism first. The purpose of this filtering is to get a
-/// sense of the runtime cost of individual checks for a benchmark. Oftentimes,
-/// the actual execution frequency (or general impact) of a (static) check on
-/// the execution time varies widely. Hence, this filter can give a handle to
-/// grasp the impact of individual checks in a benchmark, but is not a valid
-/// optimization.
+/// by RuntimeStatMechanism first, or is taken from block frequencies (with the
+/// counts of a PGO profile if one is attached to the module). The purpose of
+/// this filtering is to get a sense of the runtime cost of individual checks
+/// for a benchmark. Oftentimes, the actual execution frequency (or general
+/// impact) of a (static) check on the execution time varies widely. Hence,
+/// this filter can give a handle to grasp the impact of individual checks in a
+/// benchmark, but is not a valid optimization.
+///
+/// In budget mode, the filter does not remove a fixed ratio of the checks.
+/// Instead, it estimates the cost of each check from its frequency and the
+/// cost the instrumentation mechanism expects for it. It then keeps as many
+/// checks as possible without exceeding a given overhead relative to the
+/// profiled memory accesses. This makes the overhead comparable across
+/// builds.
 ///
 //===----------------------------------------------------------------------===//
 
@@ -53,6 +61,10 @@ public:
                           std::map<llvm::Function *, ITargetVector> &) override;
 
 private:
+  /// Invalidate the most expensive \p checks such that the estimated cost of
+  /// the remaining ones fits into the overhead budget.
+  void filterByBudget(MemInstrumentPass &, ITargetVector &checks);
+
   std::map<llvm::Instruction *, uint64_t> hotnessForAccesses;
 };
 
@@ -0,0 +1,80 @@
+//===- meminstrument/LoopInvariantCheckHoistingPass.h -----------*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Spatial checks on a pointer that does not change within a loop yield the
+/// same result in every iteration. If such a check is executed whenever the
+/// loop is entered, it can be performed once in the loop preheader instead.
+/// This optimization replaces the targets for such checks by check targets in
+/// the preheader of the outermost loop the check can be hoisted out of.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_OPTIMIZATION_LOOPINVARIANTCHECKHOISTINGPASS_H
+#define MEMINSTRUMENT_OPTIMIZATION_LOOPINVARIANTCHECKHOISTINGPASS_H
+
+#include "meminstrument/optimizations/OptimizationInterface.h"
+#include "meminstrument/pass/ITarget.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/MustExecute.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace meminstrument {
+
+class LoopInvariantCheckHoistingPass : public llvm::ModulePass,
+                                       public OptimizationInterface {
+public:
+  // ModulePass methods
+
+  /// Identification
+  static char ID;
+
+  /// Default constructor to initialize the module pass interface
+  LoopInvariantCheckHoistingPass();
+
+  virtual bool runOnModule(llvm::Module &) override;
+
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &) const override;
+
+  virtual void print(llvm::raw_ostream &, const llvm::Module *) const override;
+
+  // OptimizationInterface methods
+
+  virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
+                                         llvm::Function &) override;
+
+private:
+  /// Determine the outermost loop out of which the check \p target can be
+  /// hoisted, or nullptr if it has to stay where it is. The instrumentee and
+  /// the size of the target are moved to the preheader of that loop if they
+  /// are loop invariant but defined within the loop.
+  llvm::Loop *findHoistingLoop(const ITarget &target,
+                               const llvm::DominatorTree &,
+                               const llvm::LoopInfo &);
+
+  /// Check whether the location of \p target is executed whenever \p loop is
+  /// entered.
+  bool isExecutedOnEntry(const ITarget &target, const llvm::DominatorTree &,
+                         const llvm::Loop &loop);
+
+  /// Cached safety information per loop of the current function.
+  llvm::DenseMap<const llvm::Loop *,
+                 std::unique_ptr<llvm::SimpleLoopSafetyInfo>>
+      safetyInfos;
+
+  /// Cached information whether every instruction of a loop of the current
+  /// function is guaranteed to transfer execution to its successor.
+  llvm::DenseMap<const llvm::Loop *, bool> transfersExecution;
+};
+
+} // namespace meminstrument
+
+#endif
@@ -0,0 +1,117 @@
+//===- meminstrument/LoopRangeCheckPass.h - Loop Range Checks ---*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Accesses in a loop whose address advances by a constant stride in each
+/// iteration cover a contiguous memory range, which can be computed with
+/// ScalarEvolution whenever the trip count of the loop is known on entry.
+/// This optimization replaces the per-iteration checks for such accesses by a
+/// single check of the whole range in the loop preheader.
+///
+/// The range check is placed by the optimization itself, it requests bounds
+/// for the base pointer of the access at the preheader and compares them to
+/// the range. This way, the check can be skipped if the loop does not execute
+/// the access at all.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_OPTIMIZATION_LOOPRANGECHECKPASS_H
+#define MEMINSTRUMENT_OPTIMIZATION_LOOPRANGECHECKPASS_H
+
+#include "meminstrument/optimizations/OptimizationInterface.h"
+#include "meminstrument/pass/ITarget.h"
+#include "meminstrument/pass/Witness.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace meminstrument {
+
+class LoopRangeCheckPass : public llvm::ModulePass,
+                           public OptimizationInterface {
+public:
+  // ModulePass methods
+
+  /// Identification
+  static char ID;
+
+  /// Default constructor to initialize the module pass interface
+  LoopRangeCheckPass();
+
+  virtual bool runOnModule(llvm::Module &) override;
+
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &) const override;
+
+  virtual bool doFinalization(llvm::Module &) override;
+
+  virtual void print(llvm::raw_ostream &, const llvm::Module *) const override;
+
+  // OptimizationInterface methods
+
+  virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
+                                         llvm::Function &) override;
+
+  virtual void materializeExternalChecksForFunction(MemInstrumentPass &,
+                                                    ITargetVector &,
+                                                    llvm::Function &) override;
+
+  /// Determine the SCEVs of the lowest address and the address after the
+  /// highest address accessed by \p target in its innermost loop. \p guard is
+  /// set to a SCEV that is zero if the access is not executed at all, or to
+  /// nullptr if the access is executed whenever the loop is entered. The
+  /// pointer has to be an add-recurrence that does not wrap around. If it
+  /// cannot be shown that adding the access size to the last address does not
+  /// overflow, \p mayWrap is set and the range has to be checked for
+  /// wraparound at run time. Returns false if the accessed range cannot be
+  /// computed.
+  static bool computeAccessedRange(const ConstSizeCheckIT &target,
+                                   const llvm::Loop &loop,
+                                   const llvm::DominatorTree &,
+                                   llvm::ScalarEvolution &,
+                                   const llvm::SCEV *&low,
+                                   const llvm::SCEV *&high,
+                                   const llvm::SCEV *&guard, bool &mayWrap);
+
+  /// Create a value that is true iff the memory range [\p low, \p high)
+  /// violates the bounds of \p witness, or iff it wraps around (\p high is
+  /// below \p low) and \p checkWrap is set. If \p tripGuard is given, the
+  /// range is considered empty if it is zero.
+  static llvm::Value *createRangeViolation(llvm::IRBuilder<> &,
+                                           llvm::Value *low, llvm::Value *high,
+                                           llvm::Value *tripGuard,
+                                           const Witness &witness,
+                                           bool checkUpper, bool checkLower,
+                                           bool checkWrap);
+
+private:
+  /// A check of the memory range [low, high) against the bounds of the bounds
+  /// target, which is located in a loop preheader. If tripGuard is set, the
+  /// range is only accessed if it is not zero.
+  struct RangeCheck {
+    ITargetPtr boundsTarget;
+    llvm::Value *low = nullptr;
+    llvm::Value *high = nullptr;
+    llvm::Value *tripGuard = nullptr;
+    bool checkUpper = false;
+    bool checkLower = false;
+    bool checkWrap = false;
+  };
+
+  /// Check whether every instruction of the loop is guaranteed to transfer
+  /// execution to its successor.
+  static bool transfersExecution(const llvm::Loop &);
+
+  std::map<llvm::Function *, llvm::SmallVector<RangeCheck, 4>> WorkList;
+};
+
+} // namespace meminstrument
+
+#endif
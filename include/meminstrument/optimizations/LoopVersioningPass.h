@@ -0,0 +1,102 @@
+//===- meminstrument/LoopVersioningPass.h - Loop Versioning -----*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Loops whose accesses can be summarized as memory ranges, but whose range
+/// checks cannot replace the per-iteration checks (e.g., because the loop
+/// might be left early), are versioned. The loop is cloned before any
+/// instrumentation is placed, such that the clone runs without checks. A
+/// single up-front check of all accessed ranges decides whether the unchecked
+/// fast path or the original, instrumented loop is executed.
+///
+/// The range checks are placed by the optimization itself, analogous to the
+/// LoopRangeCheckPass. A range check that fails does not report a violation,
+/// it only selects the instrumented loop, which reports the violation at the
+/// actual access (if any).
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_OPTIMIZATION_LOOPVERSIONINGPASS_H
+#define MEMINSTRUMENT_OPTIMIZATION_LOOPVERSIONINGPASS_H
+
+#include "meminstrument/optimizations/OptimizationInterface.h"
+#include "meminstrument/pass/ITarget.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace meminstrument {
+
+class LoopVersioningPass : public llvm::ModulePass,
+                           public OptimizationInterface {
+public:
+  // ModulePass methods
+
+  /// Identification
+  static char ID;
+
+  /// Default constructor to initialize the module pass interface
+  LoopVersioningPass();
+
+  virtual bool runOnModule(llvm::Module &) override;
+
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &) const override;
+
+  virtual bool doFinalization(llvm::Module &) override;
+
+  virtual void print(llvm::raw_ostream &, const llvm::Module *) const override;
+
+  // OptimizationInterface methods
+
+  virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
+                                         llvm::Function &) override;
+
+  virtual void materializeExternalChecksForFunction(MemInstrumentPass &,
+                                                    ITargetVector &,
+                                                    llvm::Function &) override;
+
+private:
+  /// A memory range [low, high) that is accessed by the versioned loop, and
+  /// the bounds target in front of the loop to check it against. If tripGuard
+  /// is set, the range is only accessed if it is not zero.
+  struct VersionRange {
+    ITargetPtr boundsTarget;
+    llvm::Value *low = nullptr;
+    llvm::Value *high = nullptr;
+    llvm::Value *tripGuard = nullptr;
+    bool checkUpper = false;
+    bool checkLower = false;
+    bool checkWrap = false;
+  };
+
+  /// A versioned loop. The branch selects the instrumented original loop (true
+  /// successor) if a range violates its bounds, and the unchecked clone (false
+  /// successor) otherwise.
+  struct VersionedLoop {
+    llvm::BranchInst *branch = nullptr;
+    llvm::SmallVector<VersionRange, 4> ranges;
+  };
+
+  /// Check whether \p loop has a structure that allows to version it.
+  static bool isVersionable(const llvm::Loop &loop);
+
+  /// Clone \p loop and place the versioning branch in front of it. Values
+  /// defined in the loop are merged in the exit block for their uses outside
+  /// of the loop. Returns the versioning branch.
+  static llvm::BranchInst *versionLoop(llvm::Loop &loop, llvm::LoopInfo &,
+                                       llvm::DominatorTree &);
+
+  std::map<llvm::Function *, llvm::SmallVector<VersionedLoop, 2>> WorkList;
+};
+
+} // namespace meminstrument
+
+#endif
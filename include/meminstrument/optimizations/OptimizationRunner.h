@@ -33,8 +33,15 @@ namespace meminstrument {
 enum InstrumentationOptimizations {
   annotation_checkrem,
   dominance_checkrem,
+  available_checkrem,
   hotness_checkrem,
+  staticbounds_checkrem,
   example_checkopt,
+  licm_checkopt,
+  looprange_checkopt,
+  loopversion_checkopt,
+  coalesce_checkopt,
+  earlyarg_checkopt,
   pico_checkopt
 };
 
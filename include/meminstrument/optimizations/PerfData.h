@@ -16,22 +16,46 @@
 #include <cstdint>
 
 namespace llvm {
+class BasicBlock;
+class BlockFrequencyInfo;
+class ProfileSummaryInfo;
 class StringRef;
-}
+} // namespace llvm
 
 namespace meminstrument {
 
 /// Given a module name, a function name and an index of an access, retrieve
-/// the number of executions of the access from a database specified via the
+/// the number of executions of the access from a profile specified via the
 /// `-mi-profile-db-path` cli option.
 /// It returns 0 if no data is available for the given inputs.
-/// This should be generated from the results of the rt_stat instrumentation.
+/// The profile of a module is loaded once on its first lookup, all further
+/// lookups for the module are answered from memory.
 ///
-/// This requires an installation of sqlite3; if this is not available, it will
-/// return 0 in any case.
+/// The profile is either a database, which should be generated from the
+/// results of the rt_stat instrumentation, or a binary profile. Reading a
+/// database requires an installation of sqlite3; if this is not available,
+/// only binary profiles yield results.
+///
+/// A binary profile consists of little-endian 64 bit words, names are padded
+/// with zeros to a multiple of 8 bytes, such that it can be mapped into memory
+/// and read in place:
+///
+///   "MIPROF01" <number of modules>
+///   per module:   <name size> <number of functions> <name>
+///   per function: <name size> <number of accesses> <name>
+///   per access:   <access id> <number of executions>
 uint64_t getHotnessIndex(llvm::StringRef ModuleName,
                          llvm::StringRef FunctionName, uint64_t AccessId);
 
+/// Estimate the number of executions of \p Block from block frequencies. If
+/// the module carries a profile summary (e.g., from a PGO build) and the
+/// function has an entry count, the result is the profiled count. Otherwise,
+/// it is the statically estimated frequency of the block relative to the
+/// function entry, scaled by 1024 executions of the entry.
+uint64_t getBlockHotness(const llvm::BasicBlock &Block,
+                         const llvm::BlockFrequencyInfo &BFI,
+                         llvm::ProfileSummaryInfo *PSI);
+
 } // namespace meminstrument
 
 #endif
@@ -0,0 +1,57 @@
+//===- meminstrument/StaticBoundsCheckRemovalPass.h -------------*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Accesses with a constant offset into an alloca or global of a statically
+/// known size can be proven in bounds at compile time. This optimization
+/// filters out check targets for such accesses.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_OPTIMIZATION_STATICBOUNDSCHECKREMOVALPASS_H
+#define MEMINSTRUMENT_OPTIMIZATION_STATICBOUNDSCHECKREMOVALPASS_H
+
+#include "meminstrument/optimizations/OptimizationInterface.h"
+#include "meminstrument/pass/ITarget.h"
+
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+namespace meminstrument {
+
+class StaticBoundsCheckRemovalPass : public llvm::ModulePass,
+                                     public OptimizationInterface {
+public:
+  // ModulePass methods
+
+  /// Identification
+  static char ID;
+
+  /// Default constructor to initialize the module pass interface
+  StaticBoundsCheckRemovalPass();
+
+  virtual bool runOnModule(llvm::Module &) override;
+
+  virtual void getAnalysisUsage(llvm::AnalysisUsage &) const override;
+
+  virtual void print(llvm::raw_ostream &, const llvm::Module *) const override;
+
+  // OptimizationInterface methods
+
+  virtual void updateITargetsForFunction(MemInstrumentPass &, ITargetVector &,
+                                         llvm::Function &) override;
+
+private:
+  /// Check whether the access described by \p target is within the bounds of
+  /// a statically sized object.
+  bool isStaticallyInBounds(const ITarget &target,
+                            const llvm::DataLayout &) const;
+};
+
+} // namespace meminstrument
+
+#endif
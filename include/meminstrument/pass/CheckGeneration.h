@@ -8,6 +8,18 @@
 /// \file
 /// Manage check code generation.
 ///
+/// Checks can be guarded such that they are skipped at run time. With
+/// sampling, a thread-local countdown selects every Nth check. With patchable
+/// checks, each check of a labeled access gets a
+/// `{ i64 id, i8* module, i8 enabled }` entry in the `mi_sites` section and
+/// only runs while its flag is set. The linker concatenates the entries of all
+/// modules, so a run-time can find them between `__start_mi_sites` and
+/// `__stop_mi_sites` and implement `__mi_disable_site(module, id)` and
+/// `__mi_enable_site(module, id)` by writing the flags of all entries with the
+/// given module name and access ID. The module name is needed because access
+/// IDs are only unique within a module: without debug info, static functions
+/// of the same name in different modules get the same IDs.
+///
 //===----------------------------------------------------------------------===//
 
 #ifndef MEMINSTRUMENT_PASS_CHECKGENERATION_H
@@ -21,6 +33,10 @@
 
 namespace meminstrument {
 
+/// Returns true iff checks should be individually switchable at run time.
+/// Accesses have to be labeled with IDs for this.
+bool isPatchableChecksEnabled();
+
 void generateInvariants(GlobalConfig &, ITargetVector &, llvm::Function &);
 
 void generateChecks(GlobalConfig &, ITargetVector &, llvm::Function &);
@@ -0,0 +1,45 @@
+//===- meminstrument/CheckProfiler.h - Profile Check Sites ------*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Profiling overlay that counts how often each check site is executed. It
+/// can be combined with any instrumentation mechanism.
+///
+/// Each module gets an array of counters with one counter per check site, and
+/// a parallel array with the access IDs of the sites. Each function owns a
+/// slice of these arrays. Check sites increment their counter inline. A static
+/// constructor registers the module with `__mi_check_profile_register`. It
+/// passes the module name, the counters, the access IDs, and a table with one
+/// `{ i8 *name, i64 offset, i64 size }` entry per function. At exit, the
+/// run-time writes the counters to the `modulenames` and `data` tables of the
+/// profile database, which getHotnessIndex reads.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_PASS_CHECKPROFILER_H
+#define MEMINSTRUMENT_PASS_CHECKPROFILER_H
+
+#include "meminstrument/pass/ITarget.h"
+
+#include "llvm/IR/Module.h"
+
+#include <map>
+
+namespace meminstrument {
+
+/// Returns true iff the check sites should be profiled. Accesses have to be
+/// labeled with IDs for this.
+bool isCheckProfilingEnabled();
+
+/// Insert counters for the locations of the valid checks in \p targetMap and
+/// register them with the run-time.
+void insertCheckProfiler(llvm::Module &,
+                         std::map<llvm::Function *, ITargetVector> &targetMap);
+
+} // namespace meminstrument
+
+#endif
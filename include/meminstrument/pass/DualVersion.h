@@ -0,0 +1,41 @@
+//===- meminstrument/DualVersion.h - Checked/Unchecked Copies ---*- C++ -*-===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Keep an unchecked copy of every instrumented function and dispatch between
+/// the checked and the unchecked copy at function entry.
+///
+/// The dispatch reads the flag `__mi_checks_enabled` (a weak i8 that defaults
+/// to 1, so all modules share it and a run-time can provide its own). If the
+/// flag is 0, the function tail calls its unchecked copy, such that disabled
+/// checking only costs a load and a branch per call. A static constructor
+/// clears the flag if the environment variable MI_DISABLE_CHECKS is set. Other
+/// ways to switch, e.g. a signal handler, only need to write the flag.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef MEMINSTRUMENT_PASS_DUALVERSION_H
+#define MEMINSTRUMENT_PASS_DUALVERSION_H
+
+#include "meminstrument/instrumentation_mechanisms/InstrumentationMechanism.h"
+
+#include "llvm/IR/Module.h"
+
+namespace meminstrument {
+
+/// Returns true iff functions should get an unchecked copy.
+bool isDualVersionEnabled();
+
+/// Create the unchecked copies of all functions that will be instrumented and
+/// insert the dispatch. Has to run after the mechanism is initialized (so
+/// that both copies agree on the allocation instrumentation) and before the
+/// targets are gathered. The copies are marked noinstrument.
+void createDualVersions(llvm::Module &, const InstrumentationMechanism &);
+
+} // namespace meminstrument
+
+#endif
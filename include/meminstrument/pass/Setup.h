@@ -25,6 +25,11 @@ namespace meminstrument {
 /// argument), mark them such that they are not instrumented later on
 void prepareModule(llvm::Module &);
 
+/// Label the loads and stores of the function with access IDs. The IDs are
+/// hashes of the function name, the debug location, and the opcode of the
+/// access, so that profiles remain applicable after unrelated code changes.
+void labelAccesses(llvm::Function &);
+
 } // namespace meminstrument
 
 #endif
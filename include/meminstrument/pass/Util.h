@@ -116,6 +116,13 @@ bool hasPointerAccessSize(const llvm::Value *);
 /// Get the size of an access to the pointer Value V.
 size_t getPointerAccessSize(const llvm::DataLayout &, llvm::Value *);
 
+/// Determine whether \p V is an allocation whose size is known at compile
+/// time, i.e., an alloca of constant size or a global variable with a
+/// definitive initializer. If this is the case, its size in bytes is stored in
+/// \p size.
+bool getStaticAllocationSize(const llvm::DataLayout &, const llvm::Value *V,
+                             uint64_t &size);
+
 /// Determines whether the given value can hold metadata.
 bool canHoldMetadata(const llvm::Value *);
 
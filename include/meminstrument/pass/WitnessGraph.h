@@ -18,6 +18,9 @@
 #include "meminstrument/pass/ITarget.h"
 #include "meminstrument/witness_strategies/WitnessStrategy.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Allocator.h"
+
 #include <functional>
 #include <memory>
 
@@ -110,14 +113,7 @@ public:
   WitnessGraph(const llvm::Function &F, const WitnessStrategy &WS)
       : Func(F), Strategy(WS) {}
 
-  ~WitnessGraph(void) {
-    for (auto &N : ExternalNodes) {
-      delete N;
-    }
-    for (auto &N : InternalNodes) {
-      delete N;
-    }
-  }
+  ~WitnessGraph(void);
 
   /// Gets a vector of the nodes registered as externally required and that
   /// should get witnesses.
@@ -156,9 +152,29 @@ public:
   void printWitnessClasses(llvm::raw_ostream &stream) const;
 
 private:
+  /// Key for the internal node index. The flags of a WitnessSupplyIT change
+  /// during flag propagation, so they are not part of the key; nodes that only
+  /// differ in their flags share a bucket and are told apart with operator==.
+  using NodeKey =
+      std::pair<std::pair<llvm::Value *, llvm::Instruction *>, unsigned>;
+
+  static NodeKey getNodeKey(const ITarget &T);
+
+  WitnessGraphNode *allocateNode(ITargetPtr T);
+
+  void destroyNode(WitnessGraphNode *N);
+
   const llvm::Function &Func;
   const WitnessStrategy &Strategy;
 
+  /// Memory for all nodes of this graph, released at once when the graph is
+  /// destroyed.
+  llvm::BumpPtrAllocator NodeAllocator;
+
+  /// Index of the internal nodes for constant time lookup.
+  llvm::DenseMap<NodeKey, llvm::SmallVector<WitnessGraphNode *, 1>>
+      InternalNodeIndex;
+
   /// Artificial nodes that correspond to temporary intermediate
   /// targets that are inserted to generate witnesses for the externally
   /// required nodes.
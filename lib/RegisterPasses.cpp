@@ -10,15 +10,23 @@
 //===----------------------------------------------------------------------===//
 
 #include "meminstrument/optimizations/AnnotationBasedRemovalPass.h"
+#include "meminstrument/optimizations/AvailableChecksPass.h"
+#include "meminstrument/optimizations/CheckCoalescingPass.h"
 #include "meminstrument/optimizations/DominanceBasedCheckRemovalPass.h"
+#include "meminstrument/optimizations/EarlyArgumentCheckPass.h"
 #include "meminstrument/optimizations/ExampleExternalChecksPass.h"
 #include "meminstrument/optimizations/HotnessBasedCheckRemovalPass.h"
+#include "meminstrument/optimizations/LoopInvariantCheckHoistingPass.h"
+#include "meminstrument/optimizations/LoopRangeCheckPass.h"
+#include "meminstrument/optimizations/LoopVersioningPass.h"
+#include "meminstrument/optimizations/StaticBoundsCheckRemovalPass.h"
 #include "meminstrument/pass/MemInstrumentPass.h"
 
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Scalar/SimplifyCFG.h"
 #include "llvm/Transforms/Utils.h"
 
@@ -45,6 +53,18 @@ cl::opt<bool> HandleInvoke(
              "properly supports C++, where invokes often occur."),
     cl::init(false));
 
+enum CleanupPass { CP_EarlyCSE, CP_GVN, CP_LICM };
+
+cl::list<CleanupPass> CleanupPasses(
+    "mi-cleanup-passes",
+    cl::desc("Passes to run (in the given order) directly after "
+             "meminstrument to remove redundant witness and bound look-ups "
+             "and to move them out of loops:"),
+    cl::values(clEnumValN(CP_EarlyCSE, "early-cse", "Early CSE (MemorySSA)"),
+               clEnumValN(CP_GVN, "gvn", "Global value numbering"),
+               clEnumValN(CP_LICM, "licm", "Loop invariant code motion")),
+    cl::CommaSeparated);
+
 namespace meminstrument {
 static RegisterPass<MemInstrumentPass>
     RegisterMemInstrumentPass("meminstrument", "MemInstrument",
@@ -77,6 +97,45 @@ static RegisterPass<ExampleExternalChecksPass>
                                       false, // CFGOnly
                                       true); // isAnalysis
 
+static RegisterPass<LoopInvariantCheckHoistingPass>
+    RegisterLoopInvariantCheckHoistingPass(
+        "mi-loop-invariant-check-hoisting",
+        "Loop Invariant Check Hoisting Pass",
+        false, // CFGOnly
+        true); // isAnalysis
+
+static RegisterPass<LoopRangeCheckPass>
+    RegisterLoopRangeCheckPass("mi-loop-range-checks", "Loop Range Check Pass",
+                               false, // CFGOnly
+                               true); // isAnalysis
+
+static RegisterPass<LoopVersioningPass>
+    RegisterLoopVersioningPass("mi-loop-versioning", "Loop Versioning Pass",
+                               false, // CFGOnly
+                               true); // isAnalysis
+
+static RegisterPass<CheckCoalescingPass>
+    RegisterCheckCoalescingPass("mi-check-coalescing", "Check Coalescing Pass",
+                                false, // CFGOnly
+                                true); // isAnalysis
+
+static RegisterPass<AvailableChecksPass>
+    RegisterAvailableChecksPass("mi-available-checks", "Available Checks Pass",
+                                false, // CFGOnly
+                                true); // isAnalysis
+
+static RegisterPass<EarlyArgumentCheckPass>
+    RegisterEarlyArgumentCheckPass("mi-early-argument-checks",
+                                   "Early Argument Check Pass",
+                                   false, // CFGOnly
+                                   true); // isAnalysis
+
+static RegisterPass<StaticBoundsCheckRemovalPass>
+    RegisterStaticBoundsCheckRemovalPass("mi-static-bounds-check-removal",
+                                         "Static Bounds Check Removal Pass",
+                                         false, // CFGOnly
+                                         true); // isAnalysis
+
 static void registerMeminstrumentPass(const PassManagerBuilder &,
                                       legacy::PassManagerBase &PM) {
   if (NoMemInstrumentOpt) {
@@ -98,6 +157,20 @@ static void registerMeminstrumentPass(const PassManagerBuilder &,
   PM.add(createEliminateAvailableExternallyPass());
   PM.add(createStripDeadPrototypesPass());
   PM.add(createMemInstrumentPass());
+
+  for (auto cleanupPass : CleanupPasses) {
+    switch (cleanupPass) {
+    case CP_EarlyCSE:
+      PM.add(createEarlyCSEPass(/* UseMemorySSA */ true));
+      break;
+    case CP_GVN:
+      PM.add(createGVNPass());
+      break;
+    case CP_LICM:
+      PM.add(createLICMPass());
+      break;
+    }
+  }
 }
 
 static RegisterStandardPasses
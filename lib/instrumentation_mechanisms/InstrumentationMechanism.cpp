@@ -7,16 +7,71 @@
 
 #include "meminstrument/instrumentation_mechanisms/InstrumentationMechanism.h"
 
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/MemoryBuiltins.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Support/CommandLine.h"
 
 #include "meminstrument/pass/Util.h"
 
 using namespace llvm;
 using namespace meminstrument;
 
+static cl::opt<bool> StaticWitnesses(
+    "mi-static-witnesses",
+    cl::desc("Use the compile-time constant bounds of globals and fixed-size "
+             "allocas as their witnesses and check accesses to them with "
+             "inline comparisons instead of run-time lookups."),
+    cl::init(false));
+
+static cl::opt<bool> AllocationSiteWitnesses(
+    "mi-allocation-site-witnesses",
+    cl::desc("Use the allocated range as the witness of results of allocation "
+             "functions (e.g., malloc, calloc, new[]) whose size is available "
+             "as a value, and check accesses through them with inline "
+             "comparisons instead of run-time lookups."),
+    cl::init(false));
+
+static cl::opt<bool> BranchlessChecks(
+    "mi-branchless-checks",
+    cl::desc("Let inline dereference checks redirect a failing access to the "
+             "guard address with a select instead of branching to the fail "
+             "function. The access then faults deterministically."),
+    cl::init(false));
+
+static cl::opt<uint64_t> GuardAddress(
+    "mi-branchless-guard-address",
+    cl::desc("The address that failing accesses are redirected to with "
+             "-mi-branchless-checks, it has to fault on every access and fit "
+             "into a pointer (the default is non-canonical on x86-64)"),
+    cl::init(0x8000000000000000ULL));
+
+static cl::opt<bool> DeferredChecks(
+    "mi-deferred-checks",
+    cl::desc("Combine the failure conditions of the inline checks of a basic "
+             "block and branch to the fail function only before the next "
+             "escaping side effect or the end of the block"),
+    cl::init(false));
+
+STATISTIC(NumDeferredChecks,
+          "The # of inline checks whose fail branch is deferred");
+STATISTIC(NumDeferredFailBranches,
+          "The # of fail branches that combine deferred checks");
+STATISTIC(NumPoisonedAccesses,
+          "The # of inline checks lowered to a select of the guard address");
+STATISTIC(NumStaticBounds,
+          "The # of witnesses with compile-time constant bounds created");
+STATISTIC(NumAllocationSiteBounds,
+          "The # of witnesses with bounds from the allocation site created");
+
 std::unique_ptr<std::vector<Function *>>
 InstrumentationMechanism::registerCtors(
     Module &M, ArrayRef<std::pair<StringRef, int>> List) {
@@ -83,6 +138,42 @@ InstrumentationMechanism::registerCtors(
   return Functions;
 }
 
+BasicBlock *InstrumentationMechanism::insertSetupCtor(Module &M,
+                                                     StringRef Name) {
+  auto *Fun = (*registerCtors(M, std::make_pair(Name, 0)))[0];
+  auto *Entry = BasicBlock::Create(M.getContext(), "bb", Fun);
+  ReturnInst::Create(M.getContext(), Entry);
+  return Entry;
+}
+
+BasicBlock *InstrumentationMechanism::insertSetupCtor(Module &M,
+                                                     StringRef Name,
+                                                     StringRef EnvVar,
+                                                     Value *&EnvValue) {
+  auto &Ctx = M.getContext();
+  auto *StringTy = Type::getInt8PtrTy(Ctx);
+  auto GetEnvFun = M.getOrInsertFunction("getenv", StringTy, StringTy);
+
+  auto *Entry = insertSetupCtor(M, Name);
+  auto *Fun = Entry->getParent();
+  auto *Set = BasicBlock::Create(Ctx, "env_set", Fun);
+  auto *Done = BasicBlock::Create(Ctx, "done", Fun);
+  Entry->getTerminator()->eraseFromParent();
+
+  IRBuilder<> Builder(Entry);
+  auto *VarName = insertStringLiteral(M, EnvVar);
+  EnvValue = Builder.CreateCall(
+      GetEnvFun, {Builder.CreatePointerCast(VarName, StringTy)});
+  Builder.CreateCondBr(Builder.CreateIsNull(EnvValue), Done, Set);
+
+  Builder.SetInsertPoint(Set);
+  Builder.CreateBr(Done);
+
+  Builder.SetInsertPoint(Done);
+  Builder.CreateRetVoid();
+  return Set;
+}
+
 void InstrumentationMechanism::insertCommonFunctionDeclarations(
     Module &module) {
 
@@ -163,6 +254,298 @@ Instruction *InstrumentationMechanism::insertCall(IRBuilder<> &B,
   return insertCall(B, Fun, arg, "inserted.call");
 }
 
+/// Redirect the pointer operand of the load or store at Location to the
+/// guard address if FailCond holds. Returns false if Location does not
+/// dereference DerefPtr through its pointer operand.
+static bool insertPoisonedAccess(Value *FailCond, Instruction *Location,
+                                 Value *DerefPtr) {
+  if (!DerefPtr) {
+    return false;
+  }
+  Use *PtrUse = nullptr;
+  if (auto *LI = dyn_cast<LoadInst>(Location)) {
+    PtrUse = &LI->getOperandUse(LI->getPointerOperandIndex());
+  } else if (auto *SI = dyn_cast<StoreInst>(Location)) {
+    PtrUse = &SI->getOperandUse(SI->getPointerOperandIndex());
+  } else {
+    return false;
+  }
+  if (PtrUse->get()->stripPointerCasts() != DerefPtr->stripPointerCasts()) {
+    return false;
+  }
+
+  auto *Ptr = PtrUse->get();
+  auto *PtrTy = cast<PointerType>(Ptr->getType());
+  const auto &DL = Location->getModule()->getDataLayout();
+  // A truncated guard address might be null, and loads from a select of null
+  // are folded to loads from the other operand, which drops the check.
+  unsigned PtrBits = DL.getPointerSizeInBits(PtrTy->getAddressSpace());
+  if (GuardAddress == 0 || !isUIntN(PtrBits, GuardAddress)) {
+    MemInstrumentError::report(
+        "The guard address 0x" + Twine::utohexstr(GuardAddress) +
+        " of -mi-branchless-checks is not a non-null " + Twine(PtrBits) +
+        "-bit pointer, choose one with -mi-branchless-guard-address.");
+  }
+  auto *Guard = ConstantExpr::getIntToPtr(
+      ConstantInt::get(DL.getIntPtrType(PtrTy), GuardAddress), PtrTy);
+
+  // Keep the backend from turning the select back into a branch
+  IRBuilder<> Builder(Location);
+  auto *Sel = Builder.CreateSelect(FailCond, Guard, Ptr, "mi_poisoned");
+  if (auto *I = dyn_cast<Instruction>(Sel)) {
+    I->setMetadata(LLVMContext::MD_unpredictable,
+                   MDNode::get(Location->getContext(), {}));
+  }
+  PtrUse->set(Sel);
+  ++NumPoisonedAccesses;
+  return true;
+}
+
+bool InstrumentationMechanism::isEscapingSideEffect(
+    const Instruction &I) const {
+  if (isa<ReturnInst>(I) || isa<ResumeInst>(I) || isa<AtomicRMWInst>(I) ||
+      isa<AtomicCmpXchgInst>(I) || isa<FenceInst>(I)) {
+    return true;
+  }
+  if (const auto *CB = dyn_cast<CallBase>(&I)) {
+    // Calls to the run-time and debug intrinsics have no visible effect
+    if (hasNoInstrument(CB) || isa<DbgInfoIntrinsic>(CB)) {
+      return false;
+    }
+    return !CB->doesNotAccessMemory() || !CB->doesNotThrow() ||
+           !CB->willReturn();
+  }
+  if (const auto *SI = dyn_cast<StoreInst>(&I)) {
+    if (!SI->isSimple()) {
+      return true;
+    }
+    const auto *Alloca =
+        dyn_cast<AllocaInst>(getUnderlyingObject(SI->getPointerOperand()));
+    if (!Alloca) {
+      return true;
+    }
+    auto Inserted = CapturedAllocas.try_emplace(Alloca, false);
+    if (Inserted.second) {
+      Inserted.first->second =
+          PointerMayBeCaptured(Alloca, /*ReturnCaptures=*/true,
+                               /*StoreCaptures=*/true);
+    }
+    return Inserted.first->second;
+  }
+  if (const auto *LI = dyn_cast<LoadInst>(&I)) {
+    // Volatile loads might be observable, e.g., for memory-mapped I/O
+    return !LI->isSimple();
+  }
+  return false;
+}
+
+bool InstrumentationMechanism::hasDeferredChecks() { return DeferredChecks; }
+
+void InstrumentationMechanism::insertFailBranch(Value *FailCond,
+                                                Instruction *Location,
+                                                Value *DerefPtr) const {
+  assert(!isa<PHINode>(Location));
+  if (BranchlessChecks && insertPoisonedAccess(FailCond, Location, DerefPtr)) {
+    return;
+  }
+
+  if (!DeferredChecks) {
+    insertFailBranchAt(FailCond, Location);
+    return;
+  }
+
+  // The failure has to be reported before the next escaping side effect. A
+  // checked access that writes memory is one itself: if it is out of bounds,
+  // it may write to any object, whatever the pointer is based on.
+  auto *FlushPt = Location;
+  if (!Location->mayWriteToMemory()) {
+    while (!FlushPt->isTerminator() && !isEscapingSideEffect(*FlushPt)) {
+      FlushPt = FlushPt->getNextNode();
+    }
+  }
+  DeferredFailConds[Location->getFunction()][FlushPt].push_back(FailCond);
+  ++NumDeferredChecks;
+}
+
+void InstrumentationMechanism::materializeDeferredChecks(Function &F) const {
+  CapturedAllocas.clear();
+  auto It = DeferredFailConds.find(&F);
+  if (It == DeferredFailConds.end()) {
+    return;
+  }
+  for (auto &Entry : It->second) {
+    auto *FlushPt = Entry.first;
+    IRBuilder<> Builder(FlushPt);
+    Value *Cond = nullptr;
+    for (auto *FailCond : Entry.second) {
+      Cond = Cond ? Builder.CreateOr(Cond, FailCond) : FailCond;
+    }
+    insertFailBranchAt(Cond, FlushPt);
+    ++NumDeferredFailBranches;
+  }
+  DeferredFailConds.erase(It);
+}
+
+void InstrumentationMechanism::insertFailBranchAt(Value *FailCond,
+                                                  Instruction *Location) const {
+  auto *Fun = Location->getFunction();
+  auto &Ctx = Fun->getContext();
+
+  auto &FailBB = FailBlocks[Fun];
+  if (!FailBB) {
+    FailBB = BasicBlock::Create(Ctx, "mi_fail", Fun);
+    IRBuilder<> Builder(FailBB);
+    auto *Call = Builder.CreateCall(getFailFunction());
+    Call->setDoesNotReturn();
+    setNoInstrument(Call);
+    Builder.CreateUnreachable();
+  }
+
+  auto *Head = Location->getParent();
+  auto *Tail = Head->splitBasicBlock(Location, Head->getName() + ".mi_cont");
+
+  // Replace the unconditional branch introduced by the split
+  auto *OldTerm = Head->getTerminator();
+  auto *Br = BranchInst::Create(FailBB, Tail, FailCond, OldTerm);
+  Br->setMetadata(LLVMContext::MD_prof,
+                  MDBuilder(Ctx).createBranchWeights(1, (1U << 20) - 1));
+  OldTerm->eraseFromParent();
+}
+
+bool InstrumentationMechanism::insertKnownBounds(Value *Instrumentee,
+                                                 Instruction *Location,
+                                                 Type *PtrTy, Value *&Lower,
+                                                 Value *&Upper) const {
+  if (insertStaticBounds(Instrumentee, Location, PtrTy, Lower, Upper)) {
+    ++NumStaticBounds;
+    return true;
+  }
+  if (insertAllocationSiteBounds(Instrumentee, Location, PtrTy, Lower,
+                                 Upper)) {
+    ++NumAllocationSiteBounds;
+    return true;
+  }
+  return false;
+}
+
+bool InstrumentationMechanism::insertStaticBounds(Value *Instrumentee,
+                                                  Instruction *Location,
+                                                  Type *PtrTy, Value *&Lower,
+                                                  Value *&Upper) const {
+  if (!StaticWitnesses) {
+    return false;
+  }
+
+  const auto &DL = Location->getModule()->getDataLayout();
+  uint64_t Size = 0;
+  if (!getStaticAllocationSize(DL, Instrumentee, Size)) {
+    return false;
+  }
+
+  IRBuilder<> Builder(Location);
+  auto *InstrumenteeTy = cast<PointerType>(Instrumentee->getType());
+  auto *BytePtr = insertCast(
+      Builder.getInt8PtrTy(InstrumenteeTy->getAddressSpace()), Instrumentee,
+      Builder, "_static");
+  auto *End = Builder.CreateConstInBoundsGEP1_64(Builder.getInt8Ty(), BytePtr,
+                                                 Size, "mi_static_end");
+  if (auto *I = dyn_cast<Instruction>(End)) {
+    setNoInstrument(I);
+  }
+
+  Lower = insertCast(PtrTy, BytePtr, Builder, "_lower");
+  Upper = insertCast(PtrTy, End, Builder, "_upper");
+  return true;
+}
+
+bool InstrumentationMechanism::insertAllocationSiteBounds(
+    Value *Instrumentee, Instruction *Location, Type *PtrTy, Value *&Lower,
+    Value *&Upper) const {
+  if (!AllocationSiteWitnesses) {
+    return false;
+  }
+
+  auto *Call = dyn_cast<CallBase>(Instrumentee);
+  if (!Call) {
+    return false;
+  }
+
+  auto *M = Location->getModule();
+  if (!TLII) {
+    TLII = std::make_unique<TargetLibraryInfoImpl>(
+        Triple(M->getTargetTriple()));
+  }
+  TargetLibraryInfo TLI(*TLII, Call->getFunction());
+  if (!isAllocationFn(Call, &TLI)) {
+    return false;
+  }
+
+  // The size computation is inserted in front of the call, it only depends
+  // on the arguments of the call.
+  ObjectSizeOffsetEvaluator Evaluator(M->getDataLayout(), &TLI,
+                                      M->getContext());
+  auto SizeOffset = Evaluator.compute(Call);
+  if (!Evaluator.bothKnown(SizeOffset)) {
+    return false;
+  }
+  auto *Offset = dyn_cast<ConstantInt>(SizeOffset.second);
+  if (!Offset || !Offset->isZero()) {
+    return false;
+  }
+
+  IRBuilder<> Builder(Location);
+  auto *CallTy = cast<PointerType>(Call->getType());
+  auto *BytePtr =
+      insertCast(Builder.getInt8PtrTy(CallTy->getAddressSpace()), Call,
+                 Builder, "_alloc");
+  auto *End = Builder.CreateGEP(Builder.getInt8Ty(), BytePtr,
+                                SizeOffset.first, "mi_alloc_end");
+
+  // A failed allocation has empty bounds, any access through it fails.
+  auto *Failed = Builder.CreateIsNull(BytePtr);
+  auto *UpperVal =
+      Builder.CreateSelect(Failed, BytePtr, End, "mi_alloc_upper");
+  for (auto *V : {End, Failed, UpperVal}) {
+    if (auto *I = dyn_cast<Instruction>(V)) {
+      setNoInstrument(I);
+    }
+  }
+
+  Lower = insertCast(PtrTy, BytePtr, Builder, "_lower");
+  Upper = insertCast(PtrTy, UpperVal, Builder, "_upper");
+  return true;
+}
+
+void InstrumentationMechanism::insertKnownBoundsDerefCheck(
+    IRBuilder<> &Builder, Value *Lower, Value *Upper, Value *Ptr, Value *Size,
+    Instruction *Location) const {
+  // Fail if ptr < lower or ptr + size > upper
+  auto *PtrTy = cast<PointerType>(Ptr->getType());
+  auto *BytePtr = insertCast(
+      Builder.getInt8PtrTy(PtrTy->getAddressSpace()), Ptr, Builder);
+  auto *AccessEnd = Builder.CreateGEP(Builder.getInt8Ty(), BytePtr, Size);
+  auto *LowerViolated = Builder.CreateICmpULT(
+      BytePtr, Builder.CreatePointerCast(Lower, BytePtr->getType()));
+  auto *UpperViolated = Builder.CreateICmpUGT(
+      AccessEnd, Builder.CreatePointerCast(Upper, BytePtr->getType()));
+  insertFailBranch(Builder.CreateOr(LowerViolated, UpperViolated), Location,
+                   Ptr);
+}
+
+void InstrumentationMechanism::insertKnownBoundsInboundsCheck(
+    IRBuilder<> &Builder, Value *Lower, Value *Upper, Value *Ptr,
+    Instruction *Location) const {
+  // Fail if ptr < lower or ptr > upper
+  auto *PtrTy = cast<PointerType>(Ptr->getType());
+  auto *BytePtr = insertCast(
+      Builder.getInt8PtrTy(PtrTy->getAddressSpace()), Ptr, Builder);
+  auto *LowerViolated = Builder.CreateICmpULT(
+      BytePtr, Builder.CreatePointerCast(Lower, BytePtr->getType()));
+  auto *UpperViolated = Builder.CreateICmpUGT(
+      BytePtr, Builder.CreatePointerCast(Upper, BytePtr->getType()));
+  insertFailBranch(Builder.CreateOr(LowerViolated, UpperViolated), Location);
+}
+
 Value *InstrumentationMechanism::insertCast(Type *DestType, Value *FromVal,
                                             IRBuilder<> &Builder,
                                             StringRef Suffix) {
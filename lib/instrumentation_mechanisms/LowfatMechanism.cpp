@@ -27,6 +27,8 @@ STATISTIC(LowfatNumBounds, "The # of bound(pairs) materialized");
 STATISTIC(LowfatNumWitnessPhis, "The # of witness phis inserted");
 STATISTIC(LowfatNumWitnessSelects, "The # of witness selects inserted");
 STATISTIC(LowfatNumWitnessLookups, "The # of witness lookups inserted");
+STATISTIC(LowfatNumKnownBoundsChecks,
+          "The # of checks against known bounds inserted");
 STATISTIC(LowfatNumAllocsEncountered, "The # of allocas encountered");
 STATISTIC(LowfatNumAllocs, "The # of allocas transformed");
 STATISTIC(LowfatNumVariableLengthArrays,
@@ -80,6 +82,13 @@ cl::opt<bool> LazyBase(
              "pointer. Calculate the base pointer within the check."),
     cl::init(false));
 
+cl::opt<bool> InlineChecks(
+    "mi-lf-inline-checks",
+    cl::desc("Calculate base pointers and check dereferences with inline code "
+             "using constant copies of the lowfat region tables instead of "
+             "calling the run-time."),
+    cl::init(false));
+
 Value *LowfatWitness::getLowerBound(void) const { return LowerBound; }
 
 Value *LowfatWitness::getUpperBound(void) const { return UpperBound; }
@@ -87,6 +96,11 @@ Value *LowfatWitness::getUpperBound(void) const { return UpperBound; }
 LowfatWitness::LowfatWitness(Value *WitnessValue, Instruction *Location)
     : Witness(WK_Lowfat), WitnessValue(WitnessValue), Location(Location) {}
 
+LowfatWitness::LowfatWitness(Value *WitnessValue, Value *LowerBound,
+                             Value *UpperBound, Instruction *Location)
+    : Witness(WK_Lowfat), WitnessValue(WitnessValue), UpperBound(UpperBound),
+      LowerBound(LowerBound), Location(Location), KnownBounds(true) {}
+
 Instruction *LowfatWitness::getInsertionLocation() const {
   auto *Res = Location;
   while (isa<PHINode>(Res)) {
@@ -99,6 +113,8 @@ bool LowfatWitness::hasBoundsMaterialized(void) const {
   return UpperBound != nullptr && LowerBound != nullptr;
 }
 
+bool LowfatWitness::hasKnownBounds(void) const { return KnownBounds; }
+
 void LowfatMechanism::insertWitnesses(ITarget &Target) const {
   // There should be no targets without an instrumentee for lowfat
   assert(Target.hasInstrumentee());
@@ -106,6 +122,20 @@ void LowfatMechanism::insertWitnesses(ITarget &Target) const {
   auto instrumentee = Target.getInstrumentee();
 
   if (!instrumentee->getType()->isAggregateType()) {
+    // Witnesses whose bounds are known at this point (e.g., of globals or
+    // allocation sites) need no base calculation. The address of the object
+    // is a valid witness for propagation, as it is its (lowfat) base.
+    Value *Lower = nullptr;
+    Value *Upper = nullptr;
+    if (insertKnownBounds(instrumentee, Target.getLocation(), PtrArgType,
+                          Lower, Upper)) {
+      auto *casted = insertCast(WitnessType, instrumentee,
+                                Target.getLocation(), "_witness");
+      Target.setSingleBoundWitness(std::make_shared<LowfatWitness>(
+          casted, Lower, Upper, Target.getLocation()));
+      return;
+    }
+
     auto the_witness =
         getWitness(Target.getInstrumentee(), Target.getLocation());
     Target.setSingleBoundWitness(
@@ -153,6 +183,12 @@ WitnessPtr LowfatMechanism::getRelocatedClone(const Witness &wit,
   const auto *lowfatWit = dyn_cast<LowfatWitness>(&wit);
   assert(lowfatWit != nullptr);
 
+  if (lowfatWit->hasKnownBounds()) {
+    return std::make_shared<LowfatWitness>(lowfatWit->WitnessValue,
+                                           lowfatWit->LowerBound,
+                                           lowfatWit->UpperBound, location);
+  }
+
   ++LowfatNumWitnessLookups;
 
   return std::make_shared<LowfatWitness>(lowfatWit->WitnessValue, location);
@@ -183,8 +219,20 @@ void LowfatMechanism::insertCheck(ITarget &Target) const {
     }
 
     assert(Size);
-    insertCall(Builder, CheckDerefFunction,
-               std::vector<Value *>{WitnessVal, CastVal, Size});
+    if (Witness->hasKnownBounds()) {
+      insertKnownBoundsDerefCheck(Builder, Witness->LowerBound,
+                                  Witness->UpperBound, CastVal, Size,
+                                  Target.getLocation());
+      ++LowfatNumKnownBoundsChecks;
+      return;
+    }
+    if (InlineChecks) {
+      insertInlineDerefCheck(Builder, WitnessVal, CastVal, Size,
+                             Target.getLocation());
+    } else {
+      insertCall(Builder, CheckDerefFunction,
+                 std::vector<Value *>{WitnessVal, CastVal, Size});
+    }
     ++LowfatNumDereferenceChecks;
   } else {
     assert(Target.isInvariant());
@@ -194,6 +242,14 @@ void LowfatMechanism::insertCheck(ITarget &Target) const {
       return;
     }
 
+    if (Witness->hasKnownBounds()) {
+      insertKnownBoundsInboundsCheck(Builder, Witness->LowerBound,
+                                     Witness->UpperBound, CastVal,
+                                     Target.getLocation());
+      ++LowfatNumKnownBoundsChecks;
+      return;
+    }
+
     insertCall(Builder, CheckOOBFunction,
                std::vector<Value *>{WitnessVal, CastVal});
     ++LowfatNumInboundsChecks;
@@ -245,6 +301,10 @@ void LowfatMechanism::initialize(Module &module) {
   initTypes(module.getContext());
   insertFunctionDeclarations(module);
 
+  if (InlineChecks) {
+    insertRegionTables(module);
+  }
+
   if (!NoGlobalVarProtection) {
     prepareGlobals(module);
   }
@@ -317,6 +377,12 @@ WitnessPtr LowfatMechanism::getWitnessSelect(SelectInst *Sel,
 
 bool LowfatMechanism::invariantsAreChecks() const { return true; }
 
+double LowfatMechanism::getExpectedCheckCost(const ITarget &) const {
+  // The base is computed from the region tables, either in the run-time or
+  // with inline code that spares the calls.
+  return InlineChecks ? 6.0 : 12.0;
+}
+
 //===---------------------------- private ---------------------------------===//
 
 void LowfatMechanism::initTypes(LLVMContext &Ctx) {
@@ -333,30 +399,132 @@ void LowfatMechanism::insertFunctionDeclarations(Module &M) {
   auto &Ctx = M.getContext();
   auto *VoidTy = Type::getVoidTy(Ctx);
 
+  // Checks only inspect the pointer values and abort on failure. All other
+  // run-time functions are pure computations on pointer values and the
+  // constant lowfat tables.
+  auto CheckAttrs = AttributeList::get(
+      Ctx, AttributeList::FunctionIndex,
+      {Attribute::InaccessibleMemOnly, Attribute::NoUnwind});
+  auto PureAttrs = AttributeList::get(
+      Ctx, AttributeList::FunctionIndex,
+      {Attribute::ReadNone, Attribute::NoUnwind, Attribute::WillReturn,
+       Attribute::Speculatable});
+
   if (LazyBase) {
     CheckDerefFunction =
-        insertFunDecl(M, "__lowfat_check_deref_inner_witness", VoidTy,
-                      WitnessType, PtrArgType, SizeType);
+        insertFunDecl(M, "__lowfat_check_deref_inner_witness", CheckAttrs,
+                      VoidTy, WitnessType, PtrArgType, SizeType);
   } else {
-    CheckDerefFunction = insertFunDecl(M, "__lowfat_check_deref", VoidTy,
-                                       WitnessType, PtrArgType, SizeType);
+    CheckDerefFunction =
+        insertFunDecl(M, "__lowfat_check_deref", CheckAttrs, VoidTy,
+                      WitnessType, PtrArgType, SizeType);
   }
-  CheckOOBFunction =
-      insertFunDecl(M, "__lowfat_check_oob", VoidTy, WitnessType, PtrArgType);
+  CheckOOBFunction = insertFunDecl(M, "__lowfat_check_oob", CheckAttrs, VoidTy,
+                                   WitnessType, PtrArgType);
   CalcBaseFunction = insertFunDecl(M, "__lowfat_ptr_base_without_index",
-                                   WitnessType, WitnessType);
-  GetUpperBoundFunction =
-      insertFunDecl(M, "__lowfat_get_upper_bound", PtrArgType, WitnessType);
-  GetLowerBoundFunction =
-      insertFunDecl(M, "__lowfat_get_lower_bound", PtrArgType, WitnessType);
-  StackMirrorFunction =
-      insertFunDecl(M, "__lowfat_get_mirror", PtrArgType, PtrArgType, SizeType);
-  StackSizesFunction =
-      insertFunDecl(M, "__lowfat_lookup_stack_size", SizeType, SizeType);
-  StackOffsetFunction =
-      insertFunDecl(M, "__lowfat_lookup_stack_offset", SizeType, SizeType);
-  StackMaskFunction = insertFunDecl(M, "__lowfat_compute_aligned", PtrArgType,
-                                    PtrArgType, SizeType);
+                                   PureAttrs, WitnessType, WitnessType);
+  GetUpperBoundFunction = insertFunDecl(M, "__lowfat_get_upper_bound",
+                                        PureAttrs, PtrArgType, WitnessType);
+  GetLowerBoundFunction = insertFunDecl(M, "__lowfat_get_lower_bound",
+                                        PureAttrs, PtrArgType, WitnessType);
+  StackMirrorFunction = insertFunDecl(M, "__lowfat_get_mirror", PureAttrs,
+                                      PtrArgType, PtrArgType, SizeType);
+  StackSizesFunction = insertFunDecl(M, "__lowfat_lookup_stack_size",
+                                     PureAttrs, SizeType, SizeType);
+  StackOffsetFunction = insertFunDecl(M, "__lowfat_lookup_stack_offset",
+                                      PureAttrs, SizeType, SizeType);
+  StackMaskFunction = insertFunDecl(M, "__lowfat_compute_aligned", PureAttrs,
+                                    PtrArgType, PtrArgType, SizeType);
+}
+
+void LowfatMechanism::insertRegionTables(Module &M) {
+  // The tables contain one entry per region and an additional last entry that
+  // all pointers beyond the lowfat regions are mapped to. Region zero and the
+  // additional entry describe non-lowfat memory: their mask yields a base of
+  // zero and their size spans the whole address space, which results in wide
+  // bounds.
+  const size_t numRegions = sizeof(SIZES) / sizeof(SIZES[0]);
+  static_assert(sizeof(MASKS) / sizeof(MASKS[0]) == numRegions,
+                "Size and mask tables of the lowfat regions differ in size.");
+
+  SmallVector<Constant *, 64> sizes;
+  SmallVector<Constant *, 64> masks;
+  for (size_t index = 0; index <= numRegions; ++index) {
+    bool isLowfatRegion = index > 0 && index < numRegions;
+    sizes.push_back(ConstantInt::get(
+        SizeType, isLowfatRegion ? SIZES[index] : UINT64_MAX));
+    masks.push_back(
+        ConstantInt::get(SizeType, isLowfatRegion ? MASKS[index] : 0));
+  }
+
+  auto *tableType = ArrayType::get(SizeType, numRegions + 1);
+  RegionSizesTable = new GlobalVariable(
+      M, tableType, /*isConstant*/ true, GlobalValue::PrivateLinkage,
+      ConstantArray::get(tableType, sizes), "lf.region.sizes");
+  RegionSizesTable->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  setNoInstrument(RegionSizesTable);
+
+  RegionMasksTable = new GlobalVariable(
+      M, tableType, /*isConstant*/ true, GlobalValue::PrivateLinkage,
+      ConstantArray::get(tableType, masks), "lf.region.masks");
+  RegionMasksTable->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  setNoInstrument(RegionMasksTable);
+}
+
+auto LowfatMechanism::insertRegionTableLookup(IRBuilder<> &builder,
+                                              GlobalVariable *table,
+                                              Value *ptrInt) const -> Value * {
+  auto *tableType = cast<ArrayType>(table->getValueType());
+  auto *lastIndex = builder.getInt64(tableType->getNumElements() - 1);
+
+  // The region index is given by the upper bits of the pointer, clamp it to the
+  // entry for non-lowfat memory.
+  auto *index =
+      builder.CreateLShr(ptrInt, builder.getInt64(REGION_SIZE_LOG), "lf.index");
+  auto *inTable = builder.CreateICmpULT(index, lastIndex);
+  index = builder.CreateSelect(inTable, index, lastIndex, "lf.index.clamped");
+
+  auto *entryPtr =
+      builder.CreateInBoundsGEP(tableType, table, {builder.getInt64(0), index});
+  auto *entry = builder.CreateLoad(SizeType, entryPtr);
+  setNoInstrument(entry);
+  return entry;
+}
+
+auto LowfatMechanism::insertInlineBaseCalculation(IRBuilder<> &builder,
+                                                  Value *ptr) const
+    -> Value * {
+  auto *ptrInt = builder.CreatePtrToInt(ptr, SizeType);
+  auto *mask = insertRegionTableLookup(builder, RegionMasksTable, ptrInt);
+  auto *baseInt = builder.CreateAnd(ptrInt, mask);
+  return builder.CreateIntToPtr(baseInt, WitnessType, ptr->getName() + "_base");
+}
+
+void LowfatMechanism::insertInlineDerefCheck(IRBuilder<> &builder,
+                                             Value *witness, Value *ptr,
+                                             Value *size,
+                                             Instruction *location) const {
+  // Lazy witnesses are inner pointers, compute their base first.
+  if (LazyBase) {
+    witness = insertInlineBaseCalculation(builder, witness);
+  }
+
+  // Fail if ptr < base or ptr - base + size > region size
+  auto *baseInt = builder.CreatePtrToInt(witness, SizeType);
+  auto *ptrInt = builder.CreatePtrToInt(ptr, SizeType);
+  auto *regionSize =
+      insertRegionTableLookup(builder, RegionSizesTable, baseInt);
+
+  if (size->getType() != SizeType) {
+    size = builder.CreateZExtOrTrunc(size, SizeType);
+  }
+
+  auto *offset = builder.CreateSub(ptrInt, baseInt);
+  auto *accessEnd = builder.CreateAdd(offset, size);
+  auto *lowerViolated = builder.CreateICmpULT(ptrInt, baseInt);
+  auto *upperViolated = builder.CreateICmpUGT(accessEnd, regionSize);
+  insertFailBranch(builder.CreateOr(lowerViolated, upperViolated), location,
+                   ptr);
 }
 
 void LowfatMechanism::prepareGlobals(Module &module) const {
@@ -654,6 +822,10 @@ auto LowfatMechanism::getWitness(Value *incoming, Instruction *location) const
   }
 
   IRBuilder<> builder(location);
+  if (InlineChecks) {
+    return insertInlineBaseCalculation(builder, casted);
+  }
+
   auto final = insertCall(builder, CalcBaseFunction, casted,
                           casted->getName() + "_base");
   return final;
@@ -99,6 +99,13 @@ static cl::opt<BadPtrSrc> ZeroSizedArrayHandling(
             "Assign a wide upper bound to arrays of size zero. Underflows can "
             "still be detected, overflows will go unnoticed.")));
 
+static cl::opt<bool> InlineChecks(
+    "mi-sb-inline-checks",
+    cl::desc("Emit the spatial checks as inline IR comparisons that branch to "
+             "a shared fail block per function instead of calling the run-time "
+             "check functions."),
+    cl::cat(SBCategory), cl::init(false));
+
 //===----------------------------------------------------------------------===//
 //                   Implementation of SoftBoundMechanism
 //===----------------------------------------------------------------------===//
@@ -114,6 +121,15 @@ void SoftBoundMechanism::initialize(Module &module) {
     MemInstrumentError::report("Only spatial safety is currently supported.");
   }
 
+  // The run-time check functions count the executed checks if statistics are
+  // enabled, inline checks cannot do this.
+  if (InlineChecks && InternalSoftBoundConfig::hasRunTimeStatsEnabled()) {
+    MemInstrumentError::report(
+        "Misconfiguration: Inline checks cannot collect run-time statistics. "
+        "Don't use -mi-sb-inline-checks with a run-time built with "
+        "`MIRT_STATISTICS`.");
+  }
+
   // Store the context and data layout to avoid looking it up all the time
   context = &module.getContext();
   DL = &module.getDataLayout();
@@ -162,6 +178,24 @@ void SoftBoundMechanism::insertWitnesses(ITarget &target) const {
   Value *base = nullptr;
   Value *bound = nullptr;
 
+  // Bounds that are known at this point (e.g., of globals or allocation sites)
+  // are used directly, checks compare against them inline instead of calling
+  // the run-time.
+  if (insertKnownBounds(instrumentee, target.getLocation(), handles.baseTy,
+                        base, bound)) {
+    auto mdInfo = InternalSoftBoundConfig::getMetadataInfoStr();
+    if (auto inst = dyn_cast<Instruction>(base)) {
+      setMetadata(inst, mdInfo, "sb.base.known");
+    }
+    if (auto inst = dyn_cast<Instruction>(bound)) {
+      setMetadata(inst, mdInfo, "sb.bound.known");
+    }
+    std::tie(base, bound) = addBitCasts(builder, base, bound);
+    target.setSingleBoundWitness(std::make_shared<SoftBoundWitness>(
+        base, bound, instrumentee, /*knownBounds*/ true));
+    return;
+  }
+
   if (auto cb = dyn_cast<CallBase>(instrumentee)) {
 
     // Compute the locations of pointers with bounds in the witness
@@ -249,8 +283,9 @@ auto SoftBoundMechanism::getRelocatedClone(const Witness &w,
     return std::make_shared<SoftBoundVarArgWitness>(wProxy->getProxy());
   }
 
-  return std::make_shared<SoftBoundWitness>(w.getLowerBound(),
-                                            w.getUpperBound(), location);
+  return std::make_shared<SoftBoundWitness>(
+      w.getLowerBound(), w.getUpperBound(), location,
+      cast<SoftBoundWitness>(&w)->hasKnownBounds());
 }
 
 auto SoftBoundMechanism::getWitnessPhi(PHINode *phi) const -> WitnessPtr {
@@ -394,6 +429,13 @@ auto SoftBoundMechanism::getName() const -> const char * { return "SoftBound"; }
 
 bool SoftBoundMechanism::invariantsAreChecks() const { return false; }
 
+auto SoftBoundMechanism::getExpectedCheckCost(const ITarget &) const
+    -> double {
+  // The metadata is loaded from the shadow space with the witness, the check
+  // itself only compares against the bounds.
+  return InlineChecks ? 3.0 : 6.0;
+}
+
 //===---------------------------- private ---------------------------------===//
 
 void SoftBoundMechanism::replaceWrappedFunction(Module &module) const {
@@ -1776,6 +1818,21 @@ void SoftBoundMechanism::insertSpatialDereferenceCheck(
                   dbgs() << "\tLB: " << *bw->getLowerBound()
                          << "\n\tUB: " << *bw->getUpperBound() << "\n\tinstr: "
                          << *instrumentee << "\n\tsize: " << *size << "\n";);
+
+  const auto *sbWitness = dyn_cast<SoftBoundWitness>(bw.get());
+  if (InlineChecks || (sbWitness && sbWitness->hasKnownBounds())) {
+    // Fail if ptr < base or ptr + size > bound
+    auto accessEnd = builder.CreateGEP(builder.getInt8Ty(), instrumentee, size);
+    auto lowerViolated = builder.CreateICmpULT(instrumentee, args[0]);
+    auto upperViolated = builder.CreateICmpUGT(accessEnd, args[1]);
+    auto violated = builder.CreateOr(lowerViolated, upperViolated);
+    insertFailBranch(violated, target.getLocation(), instrumentee);
+
+    DEBUG_WITH_TYPE("softbound-genchecks",
+                    dbgs() << "Generated inline check: " << *violated << "\n";);
+    return;
+  }
+
   auto call = builder.CreateCall(handles.spatialCheck, args);
   setMetadata(call, InternalSoftBoundConfig::getCheckInfoStr());
 
@@ -1798,6 +1855,18 @@ void SoftBoundMechanism::insertSpatialCallCheck(
   SmallVector<Value *, 3> args = {bw->getLowerBound(), bw->getUpperBound(),
                                   instrumentee};
 
+  if (InlineChecks) {
+    // Function pointers are valid iff ptr == base == bound
+    auto notAFunction = builder.CreateICmpNE(args[0], args[1]);
+    auto notTheBase = builder.CreateICmpNE(instrumentee, args[0]);
+    auto violated = builder.CreateOr(notAFunction, notTheBase);
+    insertFailBranch(violated, target.getLocation());
+
+    DEBUG_WITH_TYPE("softbound-genchecks",
+                    dbgs() << "Generated inline check: " << *violated << "\n";);
+    return;
+  }
+
   auto call = builder.CreateCall(handles.spatialCallCheck, args);
   setMetadata(call, InternalSoftBoundConfig::getCheckInfoStr());
 
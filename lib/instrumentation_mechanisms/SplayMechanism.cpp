@@ -24,6 +24,8 @@ STATISTIC(SplayNumBounds, "The # of bound(pairs) materialized");
 STATISTIC(SplayNumWitnessPhis, "The # of witness phis inserted");
 STATISTIC(SplayNumWitnessSelects, "The # of witness selects inserted");
 STATISTIC(SplayNumWitnessLookups, "The # of witness lookups inserted");
+STATISTIC(SplayNumKnownBoundsChecks,
+          "The # of checks against known bounds inserted");
 STATISTIC(SplayNumGlobals, "The # of globals registered");
 STATISTIC(SplayNumNonSizedGlobals,
           "The # of globals non-sized globals ignored");
@@ -43,6 +45,11 @@ Value *SplayWitness::getUpperBound(void) const { return UpperBound; }
 SplayWitness::SplayWitness(Value *WitnessValue, Instruction *Location)
     : Witness(WK_Splay), WitnessValue(WitnessValue), Location(Location) {}
 
+SplayWitness::SplayWitness(Value *WitnessValue, Value *LowerBound,
+                           Value *UpperBound, Instruction *Location)
+    : Witness(WK_Splay), WitnessValue(WitnessValue), UpperBound(UpperBound),
+      LowerBound(LowerBound), Location(Location), KnownBounds(true) {}
+
 Instruction *SplayWitness::getInsertionLocation() const {
   auto *Res = Location;
   while (isa<PHINode>(Res)) {
@@ -55,6 +62,8 @@ bool SplayWitness::hasBoundsMaterialized(void) const {
   return UpperBound != nullptr && LowerBound != nullptr;
 }
 
+bool SplayWitness::hasKnownBounds(void) const { return KnownBounds; }
+
 void SplayMechanism::insertWitnesses(ITarget &Target) const {
   // There should be no targets without an instrumentee for splay
   assert(Target.hasInstrumentee());
@@ -66,6 +75,18 @@ void SplayMechanism::insertWitnesses(ITarget &Target) const {
   if (!instrumentee->getType()->isAggregateType()) {
     auto *CastVal = insertCast(WitnessType, Target.getInstrumentee(),
                                Target.getLocation(), "_witness");
+
+    // Witnesses whose bounds are known at this point (e.g., of globals or
+    // allocation sites) do not need a lookup in the splay tree.
+    Value *Lower = nullptr;
+    Value *Upper = nullptr;
+    if (insertKnownBounds(instrumentee, Target.getLocation(), PtrArgType,
+                          Lower, Upper)) {
+      Target.setSingleBoundWitness(std::make_shared<SplayWitness>(
+          CastVal, Lower, Upper, Target.getLocation()));
+      return;
+    }
+
     Target.setSingleBoundWitness(
         std::make_shared<SplayWitness>(CastVal, Target.getLocation()));
 
@@ -111,6 +132,12 @@ WitnessPtr SplayMechanism::getRelocatedClone(const Witness &wit,
   const auto *splayWit = dyn_cast<SplayWitness>(&wit);
   assert(splayWit != nullptr);
 
+  if (splayWit->hasKnownBounds()) {
+    return std::make_shared<SplayWitness>(splayWit->WitnessValue,
+                                          splayWit->LowerBound,
+                                          splayWit->UpperBound, location);
+  }
+
   ++SplayNumWitnessLookups;
 
   return std::make_shared<SplayWitness>(splayWit->WitnessValue, location);
@@ -130,7 +157,7 @@ void SplayMechanism::insertCheck(ITarget &Target) const {
   auto *CastVal = insertCast(PtrArgType, Target.getInstrumentee(), Builder);
 
   Value *NameVal = nullptr;
-  if (Verbose) {
+  if (Verbose && !Witness->hasKnownBounds()) {
     std::string Name;
     raw_string_ostream ss(Name);
     ss << *Target.getLocation() << "(";
@@ -167,6 +194,14 @@ void SplayMechanism::insertCheck(ITarget &Target) const {
 
     assert(Size);
 
+    if (Witness->hasKnownBounds()) {
+      insertKnownBoundsDerefCheck(Builder, Witness->LowerBound,
+                                  Witness->UpperBound, CastVal, Size,
+                                  Target.getLocation());
+      ++SplayNumKnownBoundsChecks;
+      return;
+    }
+
     if (Verbose) {
       insertCall(Builder, CheckDereferenceFunction,
                  std::vector<Value *>{WitnessVal, CastVal, Size, NameVal});
@@ -177,6 +212,13 @@ void SplayMechanism::insertCheck(ITarget &Target) const {
     ++SplayNumDereferenceChecks;
   } else {
     assert(Target.isInvariant());
+    if (Witness->hasKnownBounds()) {
+      insertKnownBoundsInboundsCheck(Builder, Witness->LowerBound,
+                                     Witness->UpperBound, CastVal,
+                                     Target.getLocation());
+      ++SplayNumKnownBoundsChecks;
+      return;
+    }
     if (Verbose) {
       insertCall(Builder, CheckInboundsFunction,
                  std::vector<Value *>{WitnessVal, CastVal, NameVal});
@@ -261,34 +303,53 @@ void SplayMechanism::insertFunctionDeclarations(Module &M) {
 
   bool Verbose = globalConfig.hasInstrumentVerbose();
 
+  // The splay tree is only accessed by the run-time. Checks, tree updates and
+  // bound look-ups therefore never touch memory of the program. Look-ups are
+  // not read-only: they splay the found node to the root of the tree.
+  auto TreeAccessAttrs = AttributeList::get(
+      Ctx, AttributeList::FunctionIndex,
+      {Attribute::InaccessibleMemOnly, Attribute::NoUnwind});
+  // The verbose variants additionally read their message argument.
+  auto VerboseTreeAccessAttrs = AttributeList::get(
+      Ctx, AttributeList::FunctionIndex,
+      {Attribute::InaccessibleMemOrArgMemOnly, Attribute::NoUnwind});
+  auto LookupAttrs = AttributeList::get(
+      Ctx, AttributeList::FunctionIndex,
+      {Attribute::InaccessibleMemOnly, Attribute::NoUnwind,
+       Attribute::WillReturn});
+
   if (Verbose) {
+    CheckInboundsFunction = insertFunDecl(
+        M, "__splay_check_inbounds_named", VerboseTreeAccessAttrs, VoidTy,
+        WitnessType, PtrArgType, StringTy);
+    CheckDereferenceFunction = insertFunDecl(
+        M, "__splay_check_dereference_named", VerboseTreeAccessAttrs, VoidTy,
+        WitnessType, PtrArgType, SizeType, StringTy);
+    GlobalAllocFunction = insertFunDecl(
+        M, "__splay_alloc_or_merge_with_msg", VerboseTreeAccessAttrs, VoidTy,
+        PtrArgType, SizeType, PtrArgType);
+    AllocFunction = insertFunDecl(
+        M, "__splay_alloc_or_replace_with_msg", VerboseTreeAccessAttrs, VoidTy,
+        PtrArgType, SizeType, PtrArgType);
+  } else {
     CheckInboundsFunction =
-        insertFunDecl(M, "__splay_check_inbounds_named", VoidTy, WitnessType,
-                      PtrArgType, StringTy);
+        insertFunDecl(M, "__splay_check_inbounds", TreeAccessAttrs, VoidTy,
+                      WitnessType, PtrArgType);
     CheckDereferenceFunction =
-        insertFunDecl(M, "__splay_check_dereference_named", VoidTy, WitnessType,
-                      PtrArgType, SizeType, StringTy);
+        insertFunDecl(M, "__splay_check_dereference", TreeAccessAttrs, VoidTy,
+                      WitnessType, PtrArgType, SizeType);
     GlobalAllocFunction =
-        insertFunDecl(M, "__splay_alloc_or_merge_with_msg", VoidTy, PtrArgType,
-                      SizeType, PtrArgType);
-    AllocFunction = insertFunDecl(M, "__splay_alloc_or_replace_with_msg",
-                                  VoidTy, PtrArgType, SizeType, PtrArgType);
-  } else {
-    CheckInboundsFunction = insertFunDecl(M, "__splay_check_inbounds", VoidTy,
-                                          WitnessType, PtrArgType);
-    CheckDereferenceFunction =
-        insertFunDecl(M, "__splay_check_dereference", VoidTy, WitnessType,
+        insertFunDecl(M, "__splay_alloc_or_merge", TreeAccessAttrs, VoidTy,
+                      PtrArgType, SizeType);
+    AllocFunction =
+        insertFunDecl(M, "__splay_alloc_or_replace", TreeAccessAttrs, VoidTy,
                       PtrArgType, SizeType);
-    GlobalAllocFunction = insertFunDecl(M, "__splay_alloc_or_merge", VoidTy,
-                                        PtrArgType, SizeType);
-    AllocFunction = insertFunDecl(M, "__splay_alloc_or_replace", VoidTy,
-                                  PtrArgType, SizeType);
   }
 
-  GetLowerBoundFunction =
-      insertFunDecl(M, "__splay_get_lower_as_ptr", PtrArgType, WitnessType);
-  GetUpperBoundFunction =
-      insertFunDecl(M, "__splay_get_upper_as_ptr", PtrArgType, WitnessType);
+  GetLowerBoundFunction = insertFunDecl(M, "__splay_get_lower_as_ptr",
+                                        LookupAttrs, PtrArgType, WitnessType);
+  GetUpperBoundFunction = insertFunDecl(M, "__splay_get_upper_as_ptr",
+                                        LookupAttrs, PtrArgType, WitnessType);
 
   ExtCheckCounterFunction =
       insertFunDecl(M, "__splay_inc_external_counter", VoidTy);
@@ -463,3 +524,9 @@ WitnessPtr SplayMechanism::getWitnessSelect(SelectInst *Sel,
 }
 
 bool SplayMechanism::invariantsAreChecks() const { return true; }
+
+double SplayMechanism::getExpectedCheckCost(const ITarget &) const {
+  // The bounds are looked up in the splay tree of the run-time, which takes
+  // several dependent loads besides the call to the check itself.
+  return 24.0;
+}
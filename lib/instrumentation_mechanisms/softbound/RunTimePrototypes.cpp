@@ -17,6 +17,7 @@
 
 #include "meminstrument/instrumentation_mechanisms/softbound/InternalSoftBoundConfig.h"
 #include "meminstrument/instrumentation_mechanisms/softbound/RunTimeHandles.h"
+#include "meminstrument/pass/Util.h"
 
 #include <limits>
 
@@ -24,6 +25,32 @@ using namespace llvm;
 using namespace meminstrument;
 using namespace softbound;
 
+namespace {
+
+// The shadow stack and the in-memory metadata are run-time data structures that
+// cannot be accessed by the program. Declaring this allows the optimizer to
+// remove redundant metadata look-ups and to move them out of loops.
+
+// Loads from the run-time data structures
+const Attribute::AttrKind loadAttrs[] = {
+    Attribute::ReadOnly, Attribute::InaccessibleMemOnly, Attribute::NoUnwind,
+    Attribute::WillReturn};
+
+// Updates of the run-time data structures
+const Attribute::AttrKind storeAttrs[] = {
+    Attribute::InaccessibleMemOnly, Attribute::NoUnwind, Attribute::WillReturn};
+
+// Loads that write the result to memory handed over as argument
+const Attribute::AttrKind loadToArgAttrs[] = {
+    Attribute::InaccessibleMemOrArgMemOnly, Attribute::NoUnwind,
+    Attribute::WillReturn};
+
+// Checks do not access memory of the program but might abort the execution
+const Attribute::AttrKind checkAttrs[] = {Attribute::InaccessibleMemOnly,
+                                          Attribute::NoUnwind};
+
+} // namespace
+
 //===----------------------------------------------------------------------===//
 //                   Implementation of PrototypeInserter
 //===----------------------------------------------------------------------===//
@@ -93,33 +120,46 @@ auto PrototypeInserter::insertRunTimeProtoypes() const -> RunTimeHandles {
 void PrototypeInserter::insertSpatialOnlyRunTimeProtoypes(
     RunTimeHandles &handles) const {
 
-  handles.loadInMemoryPtrInfo =
+  handles.loadInMemoryPtrInfo = addFunctionAttributes(
       createAndInsertPrototype("__softboundcets_metadata_load", voidTy,
-                               voidPtrTy, basePtrTy, boundPtrTy);
-  handles.storeInMemoryPtrInfo = createAndInsertPrototype(
-      "__softboundcets_metadata_store", voidTy, voidPtrTy, baseTy, boundTy);
+                               voidPtrTy, basePtrTy, boundPtrTy),
+      loadToArgAttrs);
+  handles.storeInMemoryPtrInfo = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_metadata_store", voidTy,
+                               voidPtrTy, baseTy, boundTy),
+      storeAttrs);
 }
 
 void PrototypeInserter::insertSpatialRunTimeProtoypes(
     RunTimeHandles &handles) const {
 
   // Shadow stack operations
-  handles.loadBaseStack = createAndInsertPrototype(
-      "__softboundcets_load_base_shadow_stack", baseTy, intTy);
-  handles.loadBoundStack = createAndInsertPrototype(
-      "__softboundcets_load_bound_shadow_stack", boundTy, intTy);
-  handles.storeBaseStack = createAndInsertPrototype(
-      "__softboundcets_store_base_shadow_stack", voidTy, baseTy, intTy);
-  handles.storeBoundStack = createAndInsertPrototype(
-      "__softboundcets_store_bound_shadow_stack", voidTy, boundTy, intTy);
+  handles.loadBaseStack = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_load_base_shadow_stack",
+                               baseTy, intTy),
+      loadAttrs);
+  handles.loadBoundStack = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_load_bound_shadow_stack",
+                               boundTy, intTy),
+      loadAttrs);
+  handles.storeBaseStack = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_store_base_shadow_stack",
+                               voidTy, baseTy, intTy),
+      storeAttrs);
+  handles.storeBoundStack = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_store_bound_shadow_stack",
+                               voidTy, boundTy, intTy),
+      storeAttrs);
 
   // Check functions
-  handles.spatialCallCheck =
+  handles.spatialCallCheck = addFunctionAttributes(
       createAndInsertPrototype("__softboundcets_spatial_call_dereference_check",
-                               voidTy, baseTy, boundTy, voidPtrTy);
-  handles.spatialCheck =
+                               voidTy, baseTy, boundTy, voidPtrTy),
+      checkAttrs);
+  handles.spatialCheck = addFunctionAttributes(
       createAndInsertPrototype("__softboundcets_spatial_dereference_check",
-                               voidTy, baseTy, boundTy, voidPtrTy, sizeTTy);
+                               voidTy, baseTy, boundTy, voidPtrTy, sizeTTy),
+      checkAttrs);
 
   // VarArg related
   handles.loadNextInfoVarArgProxy =
@@ -149,12 +189,18 @@ void PrototypeInserter::insertSetupFunctions(RunTimeHandles &handles) const {
 
 void PrototypeInserter::insertCommonFunctions(RunTimeHandles &handles) const {
 
-  handles.allocateShadowStack = createAndInsertPrototype(
-      "__softboundcets_allocate_shadow_stack_space", voidTy, intTy);
-  handles.deallocateShadowStack = createAndInsertPrototype(
-      "__softboundcets_deallocate_shadow_stack_space", voidTy);
-  handles.copyInMemoryMetadata = createAndInsertPrototype(
-      "__softboundcets_copy_metadata", voidTy, voidPtrTy, voidPtrTy, sizeTTy);
+  handles.allocateShadowStack = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_allocate_shadow_stack_space",
+                               voidTy, intTy),
+      storeAttrs);
+  handles.deallocateShadowStack = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_deallocate_shadow_stack_space",
+                               voidTy),
+      storeAttrs);
+  handles.copyInMemoryMetadata = addFunctionAttributes(
+      createAndInsertPrototype("__softboundcets_copy_metadata", voidTy,
+                               voidPtrTy, voidPtrTy, sizeTTy),
+      storeAttrs);
 
   // VarArg related
   handles.allocateVarArgProxy = createAndInsertPrototype(
@@ -188,6 +234,14 @@ void PrototypeInserter::insertStatsFunctions(RunTimeHandles &handles) const {
   }
 }
 
+auto PrototypeInserter::addFunctionAttributes(
+    Function *fun, ArrayRef<Attribute::AttrKind> kinds) const -> Function * {
+  for (auto kind : kinds) {
+    fun->addFnAttr(kind);
+  }
+  return fun;
+}
+
 template <typename... ArgsTy>
 auto PrototypeInserter::createAndInsertPrototype(const StringRef &name,
                                                  Type *retType,
@@ -201,6 +255,7 @@ auto PrototypeInserter::createAndInsertPrototype(const StringRef &name,
   // Mark the prototypes we inserted for easy recognition
   MDNode *node = MDNode::get(context, MDString::get(context, "RTPrototype"));
   fun->setMetadata(InternalSoftBoundConfig::getMetadataKind(), node);
+  setNoInstrument(fun);
 
   return fun;
 }
@@ -28,9 +28,9 @@ using namespace meminstrument;
 //===----------------------------------------------------------------------===//
 
 SoftBoundWitness::SoftBoundWitness(Value *lowerBound, Value *upperBound,
-                                   Value *ptr)
+                                   Value *ptr, bool knownBounds)
     : Witness(WK_SoftBound), lowerBound(lowerBound), upperBound(upperBound),
-      ptr(ptr) {
+      ptr(ptr), knownBounds(knownBounds) {
   assert(lowerBound && upperBound && ptr);
 }
 
@@ -38,6 +38,8 @@ auto SoftBoundWitness::getLowerBound() const -> Value * { return lowerBound; }
 
 auto SoftBoundWitness::getUpperBound() const -> Value * { return upperBound; }
 
+auto SoftBoundWitness::hasKnownBounds() const -> bool { return knownBounds; }
+
 bool SoftBoundWitness::classof(const Witness *W) {
   return W->getKind() == WK_SoftBound;
 }
@@ -0,0 +1,176 @@
+//===- AvailableChecksPass.cpp - Remove Fully Redundant Checks ------------===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/optimizations/AvailableChecksPass.h"
+
+#include "meminstrument/optimizations/DominanceBasedCheckRemovalPass.h"
+#include "meminstrument/pass/Util.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+
+using namespace llvm;
+using namespace meminstrument;
+
+STATISTIC(NumITargetsRedundant, "The # of instrumentation targets discarded "
+                                "because of available checks on all paths");
+
+//===--------------------------- ModulePass -------------------------------===//
+
+char AvailableChecksPass::ID = 0;
+
+AvailableChecksPass::AvailableChecksPass() : ModulePass(ID) {}
+
+bool AvailableChecksPass::runOnModule(Module &) {
+  LLVM_DEBUG(dbgs() << "Running Available Checks Pass\n";);
+  return false;
+}
+
+void AvailableChecksPass::getAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  analysisUsage.setPreservesAll();
+}
+
+void AvailableChecksPass::print(raw_ostream &stream,
+                                const Module *module) const {
+  stream << "Running Available Checks Pass on\n" << *module << "\n";
+}
+
+//===--------------------- OptimizationInterface --------------------------===//
+
+void AvailableChecksPass::updateITargetsForFunction(MemInstrumentPass &mip,
+                                                    ITargetVector &targets,
+                                                    Function &fun) {
+
+  auto &scalarEvolution =
+      mip.getAnalysis<ScalarEvolutionWrapperPass>(fun).getSE();
+  const auto &dataLayout = fun.getParent()->getDataLayout();
+
+  // Number the checks, each check is a fact of the analysis. Group them by
+  // their block, ordered as in the block.
+  SmallVector<ITarget *, 32> checks;
+  SmallVector<Value *, 32> bases;
+  DenseMap<BasicBlock *, SmallVector<unsigned, 8>> checksPerBlock;
+  for (auto &target : targets) {
+    if (!target->isValid()) {
+      continue;
+    }
+    if (!isa<ConstSizeCheckIT>(target) && !isa<VarSizeCheckIT>(target)) {
+      continue;
+    }
+    int64_t offset = 0;
+    checksPerBlock[target->getLocation()->getParent()].push_back(
+        checks.size());
+    checks.push_back(target.get());
+    bases.push_back(GetPointerBaseWithConstantOffset(target->getInstrumentee(),
+                                                     offset, dataLayout));
+  }
+  if (checks.size() < 2) {
+    return;
+  }
+  for (auto &entry : checksPerBlock) {
+    std::stable_sort(entry.second.begin(), entry.second.end(),
+                     [&](unsigned lhs, unsigned rhs) {
+                       auto *lhsLoc = checks[lhs]->getLocation();
+                       auto *rhsLoc = checks[rhs]->getLocation();
+                       return lhsLoc != rhsLoc && lhsLoc->comesBefore(rhsLoc);
+                     });
+  }
+
+  // Checks remain valid once they are executed, so there are no kills:
+  // out(B) = in(B) + checks(B), in(B) = intersection of out(P) for all
+  // predecessors P of B. Start with all checks being available everywhere
+  // except at the entry to compute the greatest fixed point.
+  ReversePostOrderTraversal<Function *> rpot(&fun);
+  auto *entryBlock = &fun.getEntryBlock();
+  DenseMap<const BasicBlock *, BitVector> availableIn;
+  DenseMap<const BasicBlock *, BitVector> availableOut;
+  for (auto *block : rpot) {
+    availableOut[block] = BitVector(checks.size(), true);
+  }
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto *block : rpot) {
+      BitVector in(checks.size(), block != entryBlock);
+      for (auto *pred : predecessors(block)) {
+        // Unreachable predecessors do not restrict the available checks
+        auto it = availableOut.find(pred);
+        if (it != availableOut.end()) {
+          in &= it->second;
+        }
+      }
+
+      BitVector out(in);
+      auto it = checksPerBlock.find(block);
+      if (it != checksPerBlock.end()) {
+        for (auto index : it->second) {
+          out.set(index);
+        }
+      }
+
+      availableIn[block] = std::move(in);
+      auto &oldOut = availableOut[block];
+      if (oldOut != out) {
+        oldOut = std::move(out);
+        changed = true;
+      }
+    }
+  }
+
+  // A check is redundant if a check that subsumes it is available in front of
+  // it. Checks are only invalidated after all queries, every execution path
+  // still executes the first covering check on it.
+  SmallVector<ITarget *, 16> redundant;
+  for (auto *block : rpot) {
+    auto it = checksPerBlock.find(block);
+    if (it == checksPerBlock.end()) {
+      continue;
+    }
+
+    auto available = availableIn[block];
+    auto &blockChecks = it->second;
+    for (auto groupBegin = blockChecks.begin();
+         groupBegin != blockChecks.end();) {
+      // Checks do not make checks at their own location redundant
+      auto *location = checks[*groupBegin]->getLocation();
+      auto groupEnd =
+          std::find_if(groupBegin, blockChecks.end(), [&](unsigned index) {
+            return checks[index]->getLocation() != location;
+          });
+      for (auto indexIt = groupBegin; indexIt != groupEnd; ++indexIt) {
+        auto *check = checks[*indexIt];
+        for (auto availableIndex : available.set_bits()) {
+          if (bases[availableIndex] == bases[*indexIt] &&
+              DominanceBasedCheckRemovalPass::subsumes(
+                  *checks[availableIndex], *check, scalarEvolution)) {
+            redundant.push_back(check);
+            break;
+          }
+        }
+      }
+      for (auto indexIt = groupBegin; indexIt != groupEnd; ++indexIt) {
+        available.set(*indexIt);
+      }
+      groupBegin = groupEnd;
+    }
+  }
+
+  for (auto *check : redundant) {
+    LLVM_DEBUG(dbgs() << "Removing fully redundant " << *check << "\n";);
+    check->invalidate();
+    ++NumITargetsRedundant;
+  }
+
+  LLVM_DEBUG(dbgs() << "number of remaining valid targets: "
+                    << ITargetBuilder::getNumValidITargets(targets) << "\n";);
+}
@@ -0,0 +1,178 @@
+//===- CheckCoalescingPass.cpp - Coalesce Constant Offset Checks ----------===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/optimizations/CheckCoalescingPass.h"
+
+#include "meminstrument/pass/Util.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/IRBuilder.h"
+
+using namespace llvm;
+using namespace meminstrument;
+
+STATISTIC(NumITargetsCoalesced, "The # of instrumentation targets discarded "
+                                "because of coalescing them with others");
+
+STATISTIC(NumCoalescedITargets,
+          "The # of instrumentation targets placed for coalesced checks");
+
+//===--------------------------- ModulePass -------------------------------===//
+
+char CheckCoalescingPass::ID = 0;
+
+CheckCoalescingPass::CheckCoalescingPass() : ModulePass(ID) {}
+
+bool CheckCoalescingPass::runOnModule(Module &) {
+  LLVM_DEBUG(dbgs() << "Running Check Coalescing Pass\n";);
+  return false;
+}
+
+void CheckCoalescingPass::getAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  analysisUsage.setPreservesAll();
+}
+
+void CheckCoalescingPass::print(raw_ostream &stream,
+                                const Module *module) const {
+  stream << "Running Check Coalescing Pass on\n" << *module << "\n";
+}
+
+//===--------------------- OptimizationInterface --------------------------===//
+
+void CheckCoalescingPass::updateITargetsForFunction(MemInstrumentPass &mip,
+                                                    ITargetVector &targets,
+                                                    Function &fun) {
+
+  const auto &domTree =
+      mip.getAnalysis<DominatorTreeWrapperPass>(fun).getDomTree();
+  const auto &dataLayout = fun.getParent()->getDataLayout();
+
+  // Collect the candidates per location, checks are inserted in front of
+  // their location.
+  DenseMap<Instruction *, SmallVector<ConstSizeCheckIT *, 2>> targetsPerLoc;
+  for (auto &target : targets) {
+    if (!target->isValid() || target->hasTemporalFlag()) {
+      continue;
+    }
+    if (auto *constSizeTarget = dyn_cast<ConstSizeCheckIT>(target)) {
+      targetsPerLoc[target->getLocation()].push_back(constSizeTarget);
+    }
+  }
+  if (targetsPerLoc.empty()) {
+    return;
+  }
+
+  ITargetVector coalescedTargets;
+  for (auto &block : fun) {
+
+    // Walk through the block and group the checks with the same base pointer.
+    // A group ends before the first instruction that might not continue to
+    // the next one, as the accesses after it are not guaranteed to happen.
+    MapVector<Value *, CheckGroup> openGroups;
+    auto closeGroups = [&]() {
+      for (const auto &entry : openGroups) {
+        if (entry.second.members.size() > 1) {
+          coalesce(entry.second, entry.first, domTree, coalescedTargets);
+        }
+      }
+      openGroups.clear();
+    };
+
+    for (auto &inst : block) {
+      auto it = targetsPerLoc.find(&inst);
+      if (it != targetsPerLoc.end()) {
+        for (auto *target : it->second) {
+          int64_t offset = 0;
+          auto *base = GetPointerBaseWithConstantOffset(
+              target->getInstrumentee(), offset, dataLayout);
+          auto &group = openGroups[base];
+          group.members.push_back(target);
+          group.offsets.push_back(offset);
+        }
+      }
+      if (!isGuaranteedToTransferExecutionToSuccessor(&inst)) {
+        closeGroups();
+      }
+    }
+    closeGroups();
+  }
+
+  targets.insert(targets.end(), coalescedTargets.begin(),
+                 coalescedTargets.end());
+
+  LLVM_DEBUG(dbgs() << "number of remaining valid targets: "
+                    << ITargetBuilder::getNumValidITargets(targets) << "\n";);
+}
+
+//===---------------------------- private ---------------------------------===//
+
+void CheckCoalescingPass::coalesce(const CheckGroup &group, Value *base,
+                                   const DominatorTree &domTree,
+                                   ITargetVector &targets) const {
+
+  auto *leader = group.members.front();
+  auto *location = leader->getLocation();
+
+  // Determine the covered range relative to the base pointer.
+  int64_t low = group.offsets.front();
+  int64_t high = low + leader->getAccessSize();
+  bool checkUpper = false;
+  bool checkLower = false;
+  for (size_t i = 0; i < group.members.size(); ++i) {
+    auto *member = group.members[i];
+    low = std::min(low, group.offsets[i]);
+    high = std::max(high, group.offsets[i] +
+                              static_cast<int64_t>(member->getAccessSize()));
+    checkUpper |= member->hasUpperBoundFlag();
+    checkLower |= member->hasLowerBoundFlag();
+  }
+
+  // Reuse a pointer to the lowest accessed address if one is available at the
+  // location of the leader, otherwise compute it from the base pointer.
+  Value *lowPtr = nullptr;
+  for (size_t i = 0; i < group.members.size(); ++i) {
+    auto *instrumentee = group.members[i]->getInstrumentee();
+    if (group.offsets[i] != low) {
+      continue;
+    }
+    auto *inst = dyn_cast<Instruction>(instrumentee);
+    if (!inst || domTree.dominates(inst, location)) {
+      lowPtr = instrumentee;
+      break;
+    }
+  }
+  if (!lowPtr) {
+    IRBuilder<> builder(location);
+    auto *ptrTy = cast<PointerType>(base->getType());
+    auto *bytePtr = builder.CreateBitCast(
+        base, builder.getInt8PtrTy(ptrTy->getAddressSpace()));
+    lowPtr = builder.CreateConstGEP1_64(builder.getInt8Ty(), bytePtr, low,
+                                        "mi_coalesced");
+  }
+
+  LLVM_DEBUG({
+    dbgs() << "Coalescing the checks\n";
+    for (auto *member : group.members) {
+      dbgs() << "  " << *member << "\n";
+    }
+    dbgs() << "into a check of " << (high - low) << " bytes at " << *location
+           << "\n";
+  });
+
+  for (auto *member : group.members) {
+    member->invalidate();
+    ++NumITargetsCoalesced;
+  }
+
+  targets.push_back(ITargetBuilder::createSpatialCheckTarget(
+      lowPtr, location, static_cast<size_t>(high - low), checkUpper,
+      checkLower));
+  ++NumCoalescedITargets;
+}
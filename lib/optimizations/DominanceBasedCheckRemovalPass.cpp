@@ -9,7 +9,11 @@
 
 #include "meminstrument/pass/Util.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/ScopedHashTable.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/Support/CommandLine.h"
 
@@ -55,6 +59,9 @@ void DominanceBasedCheckRemovalPass::updateITargetsForFunction(
 
   const auto &domTree =
       mip.getAnalysis<DominatorTreeWrapperPass>(fun).getDomTree();
+  auto &scalarEvolution =
+      mip.getAnalysis<ScalarEvolutionWrapperPass>(fun).getSE();
+  const auto &dataLayout = fun.getParent()->getDataLayout();
 
   // Make sure that the invariants can be optimized similar to checks in case
   // this is requested.
@@ -69,23 +76,116 @@ void DominanceBasedCheckRemovalPass::updateITargetsForFunction(
     }
   }
 
+  // Group the valid targets by their block, ordered as in the block. Targets
+  // at the same location keep their relative order from the target vector.
+  DenseMap<BasicBlock *, SmallVector<ITarget *, 8>> targetsPerBlock;
+  SmallVector<ITarget *, 8> unreachableTargets;
   for (auto &target : targets) {
-    for (auto &otherTarget : targets) {
+    if (!target->isValid() || !target->hasInstrumentee()) {
+      continue;
+    }
+    auto *block = target->getLocation()->getParent();
+    if (!domTree.isReachableFromEntry(block)) {
+      unreachableTargets.push_back(target.get());
+      continue;
+    }
+    targetsPerBlock[block].push_back(target.get());
+  }
+  for (auto &entry : targetsPerBlock) {
+    std::stable_sort(entry.second.begin(), entry.second.end(),
+                     [](const ITarget *lhs, const ITarget *rhs) {
+                       return lhs->getLocation() != rhs->getLocation() &&
+                              lhs->getLocation()->comesBefore(
+                                  rhs->getLocation());
+                     });
+  }
 
-      // Don't optimize a target based on the assumption that it itsself is
-      // checked
-      if (target == otherTarget) {
-        continue;
+  // Walk the dominator tree in preorder and keep all targets that are not
+  // subsumed by a dominating target in a scoped table, similar to EarlyCSE.
+  // The table is keyed by the base pointer the instrumentee is derived from
+  // with a constant offset, such that accesses to different offsets of the
+  // same object can subsume each other. Targets are only added to the table
+  // if they are not subsumed by a target already in scope.
+  using ScopedTable = ScopedHashTable<Value *, ITarget *>;
+  ScopedTable availableTargets;
+
+  auto getBase = [&](const ITarget *target) {
+    int64_t offset = 0;
+    return GetPointerBaseWithConstantOffset(target->getInstrumentee(), offset,
+                                            dataLayout);
+  };
+
+  struct StackEntry {
+    const DomTreeNode *node;
+    DomTreeNode::const_iterator nextChild;
+    std::unique_ptr<ScopedTable::ScopeTy> scope;
+  };
+  SmallVector<StackEntry, 32> stack;
+
+  auto enterNode = [&](const DomTreeNode *node) {
+    stack.push_back({node, node->begin(),
+                     std::make_unique<ScopedTable::ScopeTy>(availableTargets)});
+
+    auto it = targetsPerBlock.find(node->getBlock());
+    if (it == targetsPerBlock.end()) {
+      return;
+    }
+
+    auto &blockTargets = it->second;
+    for (auto groupBegin = blockTargets.begin();
+         groupBegin != blockTargets.end();) {
+      // A target does not dominate targets at its own location, hence look up
+      // all targets at a location before adding any of them to the scope.
+      auto groupEnd = std::find_if(groupBegin, blockTargets.end(),
+                                   [&](const ITarget *target) {
+                                     return target->getLocation() !=
+                                            (*groupBegin)->getLocation();
+                                   });
+      for (auto targetIt = groupBegin; targetIt != groupEnd; ++targetIt) {
+        auto *target = *targetIt;
+        for (auto candIt = availableTargets.begin(getBase(target));
+             candIt != availableTargets.end(); ++candIt) {
+          auto *candidate = *candIt;
+          // Being in scope implies dominance of the blocks, the query only
+          // makes a difference for terminators with special semantics (e.g.
+          // invokes).
+          if (subsumes(*candidate, *target, scalarEvolution) &&
+              domTree.dominates(candidate->getLocation(),
+                                target->getLocation())) {
+            target->invalidate();
+            ++NumITargetsSubsumed;
+            break;
+          }
+        }
+      }
+      for (auto targetIt = groupBegin; targetIt != groupEnd; ++targetIt) {
+        if ((*targetIt)->isValid()) {
+          availableTargets.insert(getBase(*targetIt), *targetIt);
+        }
       }
+      groupBegin = groupEnd;
+    }
+  };
 
-      // Don't compare targets if one is already invalidated
-      if (!target->isValid() || !otherTarget->isValid()) {
+  enterNode(domTree.getRootNode());
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.nextChild == top.node->end()) {
+      stack.pop_back();
+      continue;
+    }
+    enterNode(*top.nextChild++);
+  }
+
+  // Every target dominates targets in unreachable code. These are rare, so
+  // compare them with all other targets.
+  for (auto *otherTarget : unreachableTargets) {
+    for (auto &target : targets) {
+      if (target.get() == otherTarget || !target->isValid() ||
+          !otherTarget->isValid()) {
         continue;
       }
-
-      // Compare if the acccess width of one target is larger than the other one
-      // and it also dominates it.
-      if (subsumes(*target, *otherTarget) &&
+      if (subsumes(*target, *otherTarget, scalarEvolution) &&
           domTree.dominates(target->getLocation(),
                             otherTarget->getLocation())) {
         otherTarget->invalidate();
@@ -97,41 +197,69 @@ void DominanceBasedCheckRemovalPass::updateITargetsForFunction(
 
 //===---------------------------- private ---------------------------------===//
 
-bool DominanceBasedCheckRemovalPass::subsumes(const ITarget &one,
-                                              const ITarget &other) const {
+bool DominanceBasedCheckRemovalPass::subsumes(
+    const ITarget &one, const ITarget &other,
+    ScalarEvolution &scalarEvolution) {
   assert(one.isValid());
   assert(other.isValid());
 
   if (!one.hasInstrumentee() || !other.hasInstrumentee())
     return false;
 
-  // If the instrumentee is not the same, the check cannot be subsumed
-  if (one.getInstrumentee() != other.getInstrumentee())
-    return false;
-
-  // If one access has a statically larger access width than the other, it
-  // subsumes it
-  if (auto constSizeTarget = dyn_cast<ConstSizeCheckIT>(&one)) {
-    if (auto constSizeTargetOther = dyn_cast<ConstSizeCheckIT>(&other)) {
-      return constSizeTarget->getAccessSize() >=
-             constSizeTargetOther->getAccessSize();
+  if (OptimizeInvariants) {
+    if (other.isInvariant()) {
+      return one.getInstrumentee() == other.getInstrumentee() &&
+             (one.isInvariant() || isa<ConstSizeCheckIT>(&one) ||
+              isa<VarSizeCheckIT>(&one));
     }
   }
 
-  // If the accesses have the same (dynamic) width, they subsume each other
-  if (auto constSizeTarget = dyn_cast<VarSizeCheckIT>(&one)) {
-    if (auto constSizeTargetOther = dyn_cast<VarSizeCheckIT>(&other)) {
-      return constSizeTarget->getAccessSizeVal() ==
-             constSizeTargetOther->getAccessSizeVal();
-    }
+  auto *oneSize = getAccessSizeSCEV(one, scalarEvolution);
+  auto *otherSize = getAccessSizeSCEV(other, scalarEvolution);
+  if (!oneSize || !otherSize)
+    return false;
+
+  // Both instrumentees have to be derived from the same base pointer, and the
+  // access of one has to start at or before the access of other
+  const auto &dataLayout = one.getLocation()->getModule()->getDataLayout();
+  int64_t oneOffset = 0;
+  int64_t otherOffset = 0;
+  auto *oneBase = GetPointerBaseWithConstantOffset(one.getInstrumentee(),
+                                                   oneOffset, dataLayout);
+  auto *otherBase = GetPointerBaseWithConstantOffset(other.getInstrumentee(),
+                                                     otherOffset, dataLayout);
+  if (oneBase != otherBase || oneOffset > otherOffset)
+    return false;
+
+  // The access of one has to extend at least as far as the one of other, i.e.
+  // oneSize >= distance + otherSize. Compare without overflowing the unsigned
+  // access sizes.
+  auto *distance = scalarEvolution.getConstant(
+      oneSize->getType(), static_cast<uint64_t>(otherOffset - oneOffset));
+  if (!scalarEvolution.isKnownPredicate(ICmpInst::ICMP_UGE, oneSize, distance))
+    return false;
+
+  auto *remainingSize = scalarEvolution.getMinusSCEV(oneSize, distance);
+  return scalarEvolution.isKnownPredicate(ICmpInst::ICMP_UGE, remainingSize,
+                                          otherSize);
+}
+
+auto DominanceBasedCheckRemovalPass::getAccessSizeSCEV(
+    const ITarget &target, ScalarEvolution &scalarEvolution) -> const SCEV * {
+  auto *sizeTy = Type::getInt64Ty(target.getLocation()->getContext());
+
+  if (auto constSizeTarget = dyn_cast<ConstSizeCheckIT>(&target)) {
+    return scalarEvolution.getConstant(sizeTy,
+                                       constSizeTarget->getAccessSize());
   }
 
-  if (OptimizeInvariants) {
-    if (other.isInvariant()) {
-      return one.isInvariant() || isa<ConstSizeCheckIT>(&one) ||
-             isa<VarSizeCheckIT>(&one);
-    }
+  if (auto varSizeTarget = dyn_cast<VarSizeCheckIT>(&target)) {
+    auto *sizeVal = varSizeTarget->getAccessSizeVal();
+    if (!scalarEvolution.isSCEVable(sizeVal->getType()))
+      return nullptr;
+    return scalarEvolution.getNoopOrZeroExtend(
+        scalarEvolution.getSCEV(sizeVal), sizeTy);
   }
 
-  return false;
+  return nullptr;
 }
@@ -0,0 +1,262 @@
+//===- EarlyArgumentCheckPass.cpp - Check Arguments at Function Entry -----===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/optimizations/EarlyArgumentCheckPass.h"
+
+#include "meminstrument/pass/Util.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+using namespace llvm;
+using namespace meminstrument;
+
+STATISTIC(NumITargetsMovedToEntry,
+          "The # of instrumentation targets discarded because of checking "
+          "them at the function entry");
+
+STATISTIC(NumEntryITargets,
+          "The # of instrumentation targets placed at function entries");
+
+namespace {
+
+/// Range accessed relative to a pointer available at the function entry.
+struct EntryRange {
+  int64_t low = 0;
+  int64_t high = 0;
+  bool checkUpper = false;
+  bool checkLower = false;
+};
+
+/// Pointers and sizes that are available at the function entry.
+bool isAvailableAtEntry(const Value *val) {
+  return isa<Argument>(val) || isa<Constant>(val);
+}
+
+} // namespace
+
+//===--------------------------- ModulePass -------------------------------===//
+
+char EarlyArgumentCheckPass::ID = 0;
+
+EarlyArgumentCheckPass::EarlyArgumentCheckPass() : ModulePass(ID) {}
+
+bool EarlyArgumentCheckPass::runOnModule(Module &) {
+  LLVM_DEBUG(dbgs() << "Running Early Argument Check Pass\n";);
+  return false;
+}
+
+void EarlyArgumentCheckPass::getAnalysisUsage(
+    AnalysisUsage &analysisUsage) const {
+  analysisUsage.setPreservesAll();
+}
+
+void EarlyArgumentCheckPass::print(raw_ostream &stream,
+                                   const Module *module) const {
+  stream << "Running Early Argument Check Pass on\n" << *module << "\n";
+}
+
+//===--------------------- OptimizationInterface --------------------------===//
+
+void EarlyArgumentCheckPass::updateITargetsForFunction(MemInstrumentPass &mip,
+                                                       ITargetVector &targets,
+                                                       Function &fun) {
+
+  const auto &postDomTree =
+      mip.getAnalysis<PostDominatorTreeWrapperPass>(fun).getPostDomTree();
+  const auto &dataLayout = fun.getParent()->getDataLayout();
+
+  safeRegions.clear();
+
+  // Constant size checks relative to the same pointer are combined into one
+  // range, variable size checks are moved as they are.
+  MapVector<Value *, EntryRange> entryRanges;
+  MapVector<std::pair<Value *, Value *>, EntryRange> entryVarSizeChecks;
+
+  for (auto &target : targets) {
+    if (!target->isValid() || target->hasTemporalFlag()) {
+      continue;
+    }
+
+    auto *varSizeTarget = dyn_cast<VarSizeCheckIT>(target);
+    auto *constSizeTarget = dyn_cast<ConstSizeCheckIT>(target);
+    if (!varSizeTarget && !constSizeTarget) {
+      continue;
+    }
+
+    int64_t offset = 0;
+    auto *base = GetPointerBaseWithConstantOffset(target->getInstrumentee(),
+                                                  offset, dataLayout);
+    if (!isAvailableAtEntry(base)) {
+      continue;
+    }
+    if (varSizeTarget && (!isAvailableAtEntry(target->getInstrumentee()) ||
+                          !isAvailableAtEntry(
+                              varSizeTarget->getAccessSizeVal()))) {
+      continue;
+    }
+
+    if (!isAnticipatedAtEntry(target->getLocation(), postDomTree)) {
+      continue;
+    }
+
+    if (varSizeTarget) {
+      auto &range = entryVarSizeChecks[{target->getInstrumentee(),
+                                        varSizeTarget->getAccessSizeVal()}];
+      range.checkUpper |= target->hasUpperBoundFlag();
+      range.checkLower |= target->hasLowerBoundFlag();
+    } else {
+      int64_t high =
+          offset + static_cast<int64_t>(constSizeTarget->getAccessSize());
+      auto inserted = entryRanges.insert({base, EntryRange()});
+      auto &range = inserted.first->second;
+      if (inserted.second) {
+        range.low = offset;
+        range.high = high;
+      }
+      range.low = std::min(range.low, offset);
+      range.high = std::max(range.high, high);
+      range.checkUpper |= target->hasUpperBoundFlag();
+      range.checkLower |= target->hasLowerBoundFlag();
+    }
+
+    LLVM_DEBUG(dbgs() << "Moving " << *target << " to the function entry\n";);
+
+    target->invalidate();
+    ++NumITargetsMovedToEntry;
+  }
+
+  // Place the checks behind the allocas, such that they remain static even if
+  // the check splits the block.
+  auto entryIt = fun.getEntryBlock().getFirstInsertionPt();
+  while (isa<AllocaInst>(*entryIt)) {
+    ++entryIt;
+  }
+  auto *entryLoc = &*entryIt;
+
+  for (const auto &entry : entryRanges) {
+    auto *base = entry.first;
+    const auto &range = entry.second;
+
+    Value *lowPtr = base;
+    if (range.low != 0) {
+      IRBuilder<> builder(entryLoc);
+      auto *ptrTy = cast<PointerType>(base->getType());
+      auto *bytePtr = builder.CreateBitCast(
+          base, builder.getInt8PtrTy(ptrTy->getAddressSpace()));
+      lowPtr = builder.CreateConstGEP1_64(builder.getInt8Ty(), bytePtr,
+                                          range.low, "mi_entry");
+    }
+
+    targets.push_back(ITargetBuilder::createSpatialCheckTarget(
+        lowPtr, entryLoc, static_cast<size_t>(range.high - range.low),
+        range.checkUpper, range.checkLower));
+    ++NumEntryITargets;
+  }
+
+  for (const auto &entry : entryVarSizeChecks) {
+    targets.push_back(ITargetBuilder::createSpatialCheckTarget(
+        entry.first.first, entryLoc, entry.first.second,
+        entry.second.checkUpper, entry.second.checkLower));
+    ++NumEntryITargets;
+  }
+
+  LLVM_DEBUG(dbgs() << "number of remaining valid targets: "
+                    << ITargetBuilder::getNumValidITargets(targets) << "\n";);
+}
+
+//===---------------------------- private ---------------------------------===//
+
+bool EarlyArgumentCheckPass::isAnticipatedAtEntry(
+    Instruction *location, const PostDominatorTree &postDomTree) {
+
+  auto *block = location->getParent();
+  auto *entryBlock = &block->getParent()->getEntryBlock();
+  if (!postDomTree.dominates(block, entryBlock)) {
+    return false;
+  }
+
+  auto it = safeRegions.find(block);
+  if (it == safeRegions.end()) {
+    it = safeRegions.insert({block, isSafeRegionBefore(block)}).first;
+  }
+  if (!it->second) {
+    return false;
+  }
+
+  for (auto &inst : *block) {
+    if (&inst == location) {
+      return true;
+    }
+    if (!isSafeToMoveCheckOver(inst)) {
+      return false;
+    }
+  }
+  llvm_unreachable("Location not found in its block");
+}
+
+bool EarlyArgumentCheckPass::isSafeRegionBefore(BasicBlock *block) const {
+  auto *entryBlock = &block->getParent()->getEntryBlock();
+  if (block == entryBlock) {
+    return true;
+  }
+
+  // Depth-first search over the blocks reachable from the entry without
+  // passing through block. Reaching a block that is still on the stack means
+  // that the region contains a cycle.
+  SmallPtrSet<const BasicBlock *, 16> visited;
+  SmallPtrSet<const BasicBlock *, 16> onStack;
+  SmallVector<std::pair<const BasicBlock *, const_succ_iterator>, 16> stack;
+
+  auto enter = [&](const BasicBlock *current) {
+    visited.insert(current);
+    onStack.insert(current);
+    stack.push_back({current, succ_begin(current)});
+    return llvm::all_of(*current, [](const Instruction &inst) {
+      return isSafeToMoveCheckOver(inst);
+    });
+  };
+
+  if (!enter(entryBlock)) {
+    return false;
+  }
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.second == succ_end(top.first)) {
+      onStack.erase(top.first);
+      stack.pop_back();
+      continue;
+    }
+    const auto *succ = *top.second++;
+    if (succ == block) {
+      continue;
+    }
+    if (onStack.count(succ)) {
+      return false;
+    }
+    if (!visited.count(succ) && !enter(succ)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EarlyArgumentCheckPass::isSafeToMoveCheckOver(const Instruction &inst) {
+  if (!isGuaranteedToTransferExecutionToSuccessor(&inst)) {
+    return false;
+  }
+  if (const auto *call = dyn_cast<CallBase>(&inst)) {
+    return isa<DbgInfoIntrinsic>(call) || call->onlyReadsMemory() ||
+           call->hasFnAttr(Attribute::NoFree);
+  }
+  return true;
+}
@@ -7,10 +7,16 @@
 
 #include "meminstrument/optimizations/HotnessBasedCheckRemovalPass.h"
 
+#include "meminstrument/Config.h"
+#include "meminstrument/instrumentation_mechanisms/InstrumentationMechanism.h"
 #include "meminstrument/optimizations/PerfData.h"
+#include "meminstrument/pass/Setup.h"
 #include "meminstrument/pass/Util.h"
 
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/Support/CommandLine.h"
 
 using namespace llvm;
@@ -20,6 +26,7 @@ enum FilterOrdering {
   FO_random,
   FO_hottest,
   FO_coolest,
+  FO_budget,
 };
 
 cl::opt<FilterOrdering> FilterOrderingOpt(
@@ -27,10 +34,29 @@ cl::opt<FilterOrdering> FilterOrderingOpt(
     cl::desc("strategy for filtering arbitrary checks"),
     cl::values(clEnumValN(FO_random, "random", "filter checks randomly"),
                clEnumValN(FO_hottest, "hottest", "filter hottest checks"),
-               clEnumValN(FO_coolest, "coolest", "filter coolest checks")),
+               clEnumValN(FO_coolest, "coolest", "filter coolest checks"),
+               clEnumValN(FO_budget, "budget",
+                          "keep as many checks as the overhead budget "
+                          "allows")),
     cl::init(FO_random) // default
 );
 
+enum HotnessSource {
+  HS_database,
+  HS_block_frequency,
+};
+
+cl::opt<HotnessSource> HotnessSourceOpt(
+    "mi-opt-hotness-source",
+    cl::desc("source of the execution frequencies of the accesses"),
+    cl::values(clEnumValN(HS_database, "database",
+                          "profile given by -mi-profile-db-path"),
+               clEnumValN(HS_block_frequency, "block-frequency",
+                          "block frequencies, based on PGO profile counts if "
+                          "available and static estimates otherwise")),
+    cl::init(HS_database) // default
+);
+
 cl::opt<double>
     RandomFilteringRatioOpt("mi-opt-hotness-filter-ratio",
                             cl::desc("ratio of accesses that should not be "
@@ -38,6 +64,14 @@ cl::opt<double>
                             cl::init(0.5) // default
     );
 
+cl::opt<double> OverheadBudgetOpt(
+    "mi-opt-hotness-budget",
+    cl::desc("estimated run-time overhead of the checks that is allowed with "
+             "the budget ordering, relative to the cost of the profiled memory "
+             "accesses (e.g., 0.1 for 10%)"),
+    cl::init(0.1) // default
+);
+
 cl::opt<int> RandomFilteringSeedOpt("mi-opt-hotness-random-filter-seed",
                                     cl::desc("random seed for filtering"),
                                     cl::init(424242) // default
@@ -45,6 +79,9 @@ cl::opt<int> RandomFilteringSeedOpt("mi-opt-hotness-random-filter-seed",
 
 STATISTIC(HotnessCheckRemoved, "The # checks filtered by hotness");
 
+STATISTIC(HotnessCheckKeptInBudget,
+          "The # checks kept within the overhead budget");
+
 //===--------------------------- ModulePass -------------------------------===//
 
 char HotnessBasedCheckRemovalPass::ID = 0;
@@ -59,8 +96,37 @@ bool HotnessBasedCheckRemovalPass::runOnModule(Module &module) {
     return false;
   }
 
-  // Collect the annotated access ID and look up the hotness of the instruction
+  if (HotnessSourceOpt == HS_block_frequency) {
+    auto *PSI = &getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+    for (auto &fun : module) {
+      if (fun.isDeclaration()) {
+        continue;
+      }
+      auto &BFI = getAnalysis<BlockFrequencyInfoWrapperPass>(fun).getBFI();
+      for (auto &block : fun) {
+        auto hotness = getBlockHotness(block, BFI, PSI);
+        for (auto &inst : block) {
+          if (isa<StoreInst>(&inst) || isa<LoadInst>(&inst)) {
+            hotnessForAccesses[&inst] = hotness;
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  // Collect the annotated access ID and look up the hotness of the instruction.
+  // The IDs are stable, so functions without labels can be labeled here
+  // already. Labels are metadata only, all analyses are preserved.
+  bool modified = false;
   for (auto &fun : module) {
+    bool hasLabels = llvm::any_of(instructions(fun), [](Instruction &inst) {
+      return hasAccessID(&inst);
+    });
+    if (!fun.isDeclaration() && !hasLabels) {
+      labelAccesses(fun);
+      modified = true;
+    }
     for (auto &block : fun) {
       for (auto &inst : block) {
         if (isa<StoreInst>(&inst) || isa<LoadInst>(&inst)) {
@@ -74,11 +140,15 @@ bool HotnessBasedCheckRemovalPass::runOnModule(Module &module) {
     }
   }
 
-  return false;
+  return modified;
 }
 
 void HotnessBasedCheckRemovalPass::getAnalysisUsage(
     AnalysisUsage &analysisUsage) const {
+  if (HotnessSourceOpt == HS_block_frequency) {
+    analysisUsage.addRequired<BlockFrequencyInfoWrapperPass>();
+    analysisUsage.addRequired<ProfileSummaryInfoWrapperPass>();
+  }
   analysisUsage.setPreservesAll();
 }
 
@@ -122,6 +192,11 @@ void HotnessBasedCheckRemovalPass::updateITargetsForModule(
     }
   }
 
+  if (FilterOrderingOpt == FO_budget) {
+    filterByBudget(mip, cpy);
+    return;
+  }
+
   if (FilterOrderingOpt == FO_random) {
     std::srand(RandomFilteringSeedOpt);
     std::random_shuffle(cpy.begin(), cpy.end());
@@ -142,3 +217,52 @@ void HotnessBasedCheckRemovalPass::updateITargetsForModule(
     cpy[i]->invalidate();
   }
 }
+
+//===---------------------------- private ---------------------------------===//
+
+void HotnessBasedCheckRemovalPass::filterByBudget(MemInstrumentPass &mip,
+                                                  ITargetVector &checks) {
+
+  // Make sure a valid budget is given
+  assert(OverheadBudgetOpt >= 0);
+
+  auto &IM = mip.getConfig().getInstrumentationMechanism();
+
+  // Each profiled memory access is assumed to cost one unit, executing a check
+  // costs its frequency times the cost the mechanism expects for it.
+  double baseline = 0;
+  for (const auto &entry : hotnessForAccesses) {
+    baseline += entry.second;
+  }
+  double budget = baseline * OverheadBudgetOpt;
+
+  std::vector<std::pair<double, ITargetPtr>> weighted;
+  for (auto &target : checks) {
+    auto heat = hotnessForAccesses[target->getLocation()];
+    weighted.push_back({heat * IM.getExpectedCheckCost(*target), target});
+  }
+
+  // Every kept check protects one access, i.e., all checks have the same
+  // value in this knapsack problem. Keeping the cheapest checks first is
+  // therefore optimal.
+  std::stable_sort(weighted.begin(), weighted.end(),
+                   [](const std::pair<double, ITargetPtr> &a,
+                      const std::pair<double, ITargetPtr> &b) {
+                     return a.first < b.first;
+                   });
+
+  double spent = 0;
+  for (auto &entry : weighted) {
+    if (spent + entry.first <= budget) {
+      spent += entry.first;
+      HotnessCheckKeptInBudget++;
+      continue;
+    }
+    HotnessCheckRemoved++;
+    entry.second->invalidate();
+  }
+
+  LLVM_DEBUG(dbgs() << "Spent " << spent << " of the overhead budget of "
+                    << budget << " for " << baseline
+                    << " profiled accesses\n";);
+}
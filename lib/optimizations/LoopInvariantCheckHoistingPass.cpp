@@ -0,0 +1,209 @@
+//===- LoopInvariantCheckHoistingPass.cpp - Hoist Loop Invariant Checks ---===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/optimizations/LoopInvariantCheckHoistingPass.h"
+
+#include "meminstrument/pass/Util.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ValueTracking.h"
+
+using namespace llvm;
+using namespace meminstrument;
+
+STATISTIC(NumITargetsHoisted, "The # of instrumentation targets discarded "
+                              "because of hoisting them out of a loop");
+
+STATISTIC(NumHoistedITargets,
+          "The # of instrumentation targets placed in loop preheaders");
+
+namespace {
+
+/// Description of a check that replaces one or more hoisted checks.
+struct HoistedCheck {
+  size_t accessSize = 0;
+  bool checkUpper = false;
+  bool checkLower = false;
+};
+
+/// Checks are hoisted to the terminator of a preheader. Checks that end up at
+/// the same location, for the same instrumentee, and with the same access size
+/// value (nullptr for constant sizes) are combined.
+using HoistedCheckKey = std::pair<std::pair<Instruction *, Value *>, Value *>;
+
+} // namespace
+
+//===--------------------------- ModulePass -------------------------------===//
+
+char LoopInvariantCheckHoistingPass::ID = 0;
+
+LoopInvariantCheckHoistingPass::LoopInvariantCheckHoistingPass()
+    : ModulePass(ID) {}
+
+bool LoopInvariantCheckHoistingPass::runOnModule(Module &) {
+  LLVM_DEBUG(dbgs() << "Running Loop Invariant Check Hoisting Pass\n";);
+  return false;
+}
+
+void LoopInvariantCheckHoistingPass::getAnalysisUsage(
+    AnalysisUsage &analysisUsage) const {
+  analysisUsage.setPreservesAll();
+}
+
+void LoopInvariantCheckHoistingPass::print(raw_ostream &stream,
+                                           const Module *module) const {
+  stream << "Running Loop Invariant Check Hoisting Pass on\n"
+         << *module << "\n";
+}
+
+//===--------------------- OptimizationInterface --------------------------===//
+
+void LoopInvariantCheckHoistingPass::updateITargetsForFunction(
+    MemInstrumentPass &mip, ITargetVector &targets, Function &fun) {
+
+  const auto &loopInfo =
+      mip.getAnalysis<LoopInfoWrapperPass>(fun).getLoopInfo();
+  if (loopInfo.empty()) {
+    return;
+  }
+  const auto &domTree =
+      mip.getAnalysis<DominatorTreeWrapperPass>(fun).getDomTree();
+
+  safetyInfos.clear();
+  transfersExecution.clear();
+
+  MapVector<HoistedCheckKey, HoistedCheck> hoistedChecks;
+
+  for (auto &target : targets) {
+    if (!target->isValid() || target->hasTemporalFlag()) {
+      continue;
+    }
+    if (!isa<ConstSizeCheckIT>(target) && !isa<VarSizeCheckIT>(target)) {
+      continue;
+    }
+
+    auto *loop = findHoistingLoop(*target, domTree, loopInfo);
+    if (!loop) {
+      continue;
+    }
+
+    Value *sizeVal = nullptr;
+    size_t accessSize = 0;
+    if (auto *varSizeTarget = dyn_cast<VarSizeCheckIT>(target)) {
+      sizeVal = varSizeTarget->getAccessSizeVal();
+    } else {
+      accessSize = cast<ConstSizeCheckIT>(target)->getAccessSize();
+    }
+
+    auto *location = loop->getLoopPreheader()->getTerminator();
+    auto &hoisted =
+        hoistedChecks[{{location, target->getInstrumentee()}, sizeVal}];
+    hoisted.accessSize = std::max(hoisted.accessSize, accessSize);
+    hoisted.checkUpper |= target->hasUpperBoundFlag();
+    hoisted.checkLower |= target->hasLowerBoundFlag();
+
+    LLVM_DEBUG(dbgs() << "Hoisting " << *target << " to the preheader of "
+                      << loop->getHeader()->getName() << "\n";);
+
+    target->invalidate();
+    ++NumITargetsHoisted;
+  }
+
+  for (const auto &entry : hoistedChecks) {
+    auto *location = entry.first.first.first;
+    auto *instrumentee = entry.first.first.second;
+    auto *sizeVal = entry.first.second;
+    const auto &hoisted = entry.second;
+
+    if (sizeVal) {
+      targets.push_back(ITargetBuilder::createSpatialCheckTarget(
+          instrumentee, location, sizeVal, hoisted.checkUpper,
+          hoisted.checkLower));
+    } else {
+      targets.push_back(ITargetBuilder::createSpatialCheckTarget(
+          instrumentee, location, hoisted.accessSize, hoisted.checkUpper,
+          hoisted.checkLower));
+    }
+    ++NumHoistedITargets;
+  }
+
+  LLVM_DEBUG(dbgs() << "number of remaining valid targets: "
+                    << ITargetBuilder::getNumValidITargets(targets) << "\n";);
+}
+
+//===---------------------------- private ---------------------------------===//
+
+Loop *LoopInvariantCheckHoistingPass::findHoistingLoop(
+    const ITarget &target, const DominatorTree &domTree,
+    const LoopInfo &loopInfo) {
+
+  Value *sizeVal = nullptr;
+  if (auto *varSizeTarget = dyn_cast<VarSizeCheckIT>(&target)) {
+    sizeVal = varSizeTarget->getAccessSizeVal();
+  }
+
+  Loop *hoistingLoop = nullptr;
+  for (auto *loop = loopInfo.getLoopFor(target.getLocation()->getParent());
+       loop; loop = loop->getParentLoop()) {
+
+    // Only hoist to an existing preheader, we do not modify the CFG here.
+    auto *preheader = loop->getLoopPreheader();
+    if (!preheader || !isExecutedOnEntry(target, domTree, *loop)) {
+      break;
+    }
+
+    // Pointer arithmetic in the loop that only depends on loop invariant
+    // values is moved to the preheader.
+    bool changed = false;
+    auto *insertPt = preheader->getTerminator();
+    if (!loop->makeLoopInvariant(target.getInstrumentee(), changed, insertPt)) {
+      break;
+    }
+    if (sizeVal && !loop->makeLoopInvariant(sizeVal, changed, insertPt)) {
+      break;
+    }
+
+    hoistingLoop = loop;
+  }
+
+  return hoistingLoop;
+}
+
+bool LoopInvariantCheckHoistingPass::isExecutedOnEntry(
+    const ITarget &target, const DominatorTree &domTree, const Loop &loop) {
+
+  // Moving a check in front of an instruction that might not return would
+  // report violations in executions that never reach the checked access.
+  auto transfersIt = transfersExecution.find(&loop);
+  if (transfersIt == transfersExecution.end()) {
+    bool allTransfer = true;
+    for (auto *block : loop.blocks()) {
+      for (auto &inst : *block) {
+        if (!isGuaranteedToTransferExecutionToSuccessor(&inst)) {
+          allTransfer = false;
+          break;
+        }
+      }
+      if (!allTransfer) {
+        break;
+      }
+    }
+    transfersIt = transfersExecution.insert({&loop, allTransfer}).first;
+  }
+  if (!transfersIt->second) {
+    return false;
+  }
+
+  auto &safetyInfo = safetyInfos[&loop];
+  if (!safetyInfo) {
+    safetyInfo = std::make_unique<SimpleLoopSafetyInfo>();
+    safetyInfo->computeLoopSafetyInfo(&loop);
+  }
+  return safetyInfo->isGuaranteedToExecute(*target.getLocation(), &domTree,
+                                           &loop);
+}
@@ -0,0 +1,336 @@
+//===- LoopRangeCheckPass.cpp - Range Checks for Strided Loop Accesses ----===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/optimizations/LoopRangeCheckPass.h"
+
+#include "meminstrument/Config.h"
+#include "meminstrument/instrumentation_mechanisms/InstrumentationMechanism.h"
+#include "meminstrument/pass/Witness.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+#include "meminstrument/pass/Util.h"
+
+using namespace llvm;
+using namespace meminstrument;
+
+STATISTIC(NumITargetsRangeChecked,
+          "The # of instrumentation targets discarded because of loop range "
+          "checks");
+
+STATISTIC(NumRangeChecks, "The # of loop range checks inserted");
+
+namespace {
+
+/// Range checks are identified by the accessed range, the preheader they are
+/// placed in, and the guard that tells whether the range is accessed at all.
+using RangeKey = std::pair<std::pair<const SCEV *, const SCEV *>,
+                           std::pair<BasicBlock *, const SCEV *>>;
+
+/// Information collected for a range check before its code is expanded.
+struct RangeInfo {
+  Value *base = nullptr;
+  bool checkUpper = false;
+  bool checkLower = false;
+  bool checkWrap = false;
+};
+
+} // namespace
+
+//===--------------------------- ModulePass -------------------------------===//
+
+char LoopRangeCheckPass::ID = 0;
+
+LoopRangeCheckPass::LoopRangeCheckPass() : ModulePass(ID) {}
+
+bool LoopRangeCheckPass::runOnModule(Module &) {
+  LLVM_DEBUG(dbgs() << "Running Loop Range Check Pass\n";);
+  return false;
+}
+
+void LoopRangeCheckPass::getAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  analysisUsage.setPreservesAll();
+}
+
+bool LoopRangeCheckPass::doFinalization(Module &) {
+  WorkList.clear();
+  return false;
+}
+
+void LoopRangeCheckPass::print(raw_ostream &stream,
+                               const Module *module) const {
+  stream << "Running Loop Range Check Pass on\n" << *module << "\n";
+}
+
+//===--------------------- OptimizationInterface --------------------------===//
+
+void LoopRangeCheckPass::updateITargetsForFunction(MemInstrumentPass &mip,
+                                                   ITargetVector &targets,
+                                                   Function &fun) {
+
+  const auto &loopInfo =
+      mip.getAnalysis<LoopInfoWrapperPass>(fun).getLoopInfo();
+  if (loopInfo.empty()) {
+    return;
+  }
+  const auto &domTree =
+      mip.getAnalysis<DominatorTreeWrapperPass>(fun).getDomTree();
+  auto &scalarEvolution =
+      mip.getAnalysis<ScalarEvolutionWrapperPass>(fun).getSE();
+
+  DenseMap<const Loop *, bool> loopTransfersExecution;
+  MapVector<RangeKey, RangeInfo> ranges;
+
+  for (auto &target : targets) {
+    if (!target->isValid() || target->hasTemporalFlag()) {
+      continue;
+    }
+    auto *constSizeTarget = dyn_cast<ConstSizeCheckIT>(target);
+    if (!constSizeTarget) {
+      continue;
+    }
+
+    auto *loop = loopInfo.getLoopFor(target->getLocation()->getParent());
+    if (!loop || !loop->getLoopPreheader()) {
+      continue;
+    }
+
+    // A check in the preheader must not report a violation if the loop is
+    // left before the access is executed.
+    auto transfersIt = loopTransfersExecution.find(loop);
+    if (transfersIt == loopTransfersExecution.end()) {
+      transfersIt =
+          loopTransfersExecution.insert({loop, transfersExecution(*loop)})
+              .first;
+    }
+    if (!transfersIt->second) {
+      continue;
+    }
+
+    const SCEV *low = nullptr;
+    const SCEV *high = nullptr;
+    const SCEV *guard = nullptr;
+    bool mayWrap = false;
+    if (!computeAccessedRange(*constSizeTarget, *loop, domTree,
+                              scalarEvolution, low, high, guard, mayWrap)) {
+      continue;
+    }
+
+    // The bounds of the range are those of the pointer the access is based
+    // on, which has to be available in the preheader.
+    auto *location = loop->getLoopPreheader()->getTerminator();
+    auto *baseSCEV = dyn_cast<SCEVUnknown>(scalarEvolution.getPointerBase(low));
+    if (!baseSCEV) {
+      continue;
+    }
+    auto *base = baseSCEV->getValue();
+    if (auto *baseInst = dyn_cast<Instruction>(base)) {
+      if (!domTree.dominates(baseInst, location)) {
+        continue;
+      }
+    }
+
+    if (!isSafeToExpandAt(low, location, scalarEvolution) ||
+        !isSafeToExpandAt(high, location, scalarEvolution) ||
+        (guard && !isSafeToExpandAt(guard, location, scalarEvolution))) {
+      continue;
+    }
+
+    auto &range = ranges[{{low, high}, {location->getParent(), guard}}];
+    range.base = base;
+    range.checkUpper |= target->hasUpperBoundFlag();
+    range.checkLower |= target->hasLowerBoundFlag();
+    range.checkWrap |= mayWrap;
+
+    LLVM_DEBUG(dbgs() << "Replacing " << *target
+                      << " by a range check in the preheader of "
+                      << loop->getHeader()->getName() << "\n";);
+
+    target->invalidate();
+    ++NumITargetsRangeChecked;
+  }
+
+  if (ranges.empty()) {
+    return;
+  }
+
+  // Materialize the range in the preheader, the bounds to compare it with are
+  // requested through bounds targets.
+  auto &currentWL = WorkList[&fun];
+  SCEVExpander expander(scalarEvolution, fun.getParent()->getDataLayout(),
+                        "mi_range");
+  for (const auto &entry : ranges) {
+    auto *location = entry.first.second.first->getTerminator();
+    const auto &range = entry.second;
+
+    RangeCheck rangeCheck;
+    rangeCheck.low =
+        expander.expandCodeFor(entry.first.first.first, nullptr, location);
+    rangeCheck.high =
+        expander.expandCodeFor(entry.first.first.second, nullptr, location);
+    if (auto *guard = entry.first.second.second) {
+      rangeCheck.tripGuard = expander.expandCodeFor(guard, nullptr, location);
+    }
+    rangeCheck.checkUpper = range.checkUpper;
+    rangeCheck.checkLower = range.checkLower;
+    rangeCheck.checkWrap = range.checkWrap;
+    rangeCheck.boundsTarget = ITargetBuilder::createBoundsTarget(
+        range.base, location, range.checkUpper, range.checkLower);
+
+    targets.push_back(rangeCheck.boundsTarget);
+    currentWL.push_back(rangeCheck);
+  }
+
+  LLVM_DEBUG(dbgs() << "number of remaining valid targets: "
+                    << ITargetBuilder::getNumValidITargets(targets) << "\n";);
+}
+
+void LoopRangeCheckPass::materializeExternalChecksForFunction(
+    MemInstrumentPass &mip, ITargetVector &, Function &fun) {
+  auto &cfg = mip.getConfig();
+  auto &IM = cfg.getInstrumentationMechanism();
+
+  for (auto &rangeCheck : WorkList[&fun]) {
+    auto *location = rangeCheck.boundsTarget->getLocation();
+    auto witness = rangeCheck.boundsTarget->getSingleBoundWitness();
+    IRBuilder<> builder(location);
+
+    auto *violation = createRangeViolation(
+        builder, rangeCheck.low, rangeCheck.high, rangeCheck.tripGuard,
+        *witness, rangeCheck.checkUpper, rangeCheck.checkLower,
+        rangeCheck.checkWrap);
+
+    IM.insertFailBranch(violation, location);
+    rangeCheck.boundsTarget->invalidate();
+    ++NumRangeChecks;
+  }
+}
+
+//===---------------------------- private ---------------------------------===//
+
+bool LoopRangeCheckPass::computeAccessedRange(
+    const ConstSizeCheckIT &target, const Loop &loop,
+    const DominatorTree &domTree, ScalarEvolution &scalarEvolution,
+    const SCEV *&low, const SCEV *&high, const SCEV *&guard, bool &mayWrap) {
+
+  // The addresses of the iterations only form a range if they do not wrap
+  // around (no unsigned or signed wrap implies no self-wrap).
+  auto *ptrSCEV = dyn_cast<SCEVAddRecExpr>(
+      scalarEvolution.getSCEV(target.getInstrumentee()));
+  if (!ptrSCEV || ptrSCEV->getLoop() != &loop || !ptrSCEV->isAffine() ||
+      !ptrSCEV->getNoWrapFlags(SCEV::FlagNW)) {
+    return false;
+  }
+  auto *step =
+      dyn_cast<SCEVConstant>(ptrSCEV->getStepRecurrence(scalarEvolution));
+  if (!step || step->isZero()) {
+    return false;
+  }
+
+  auto *latch = loop.getLoopLatch();
+  auto *backedgeTaken = scalarEvolution.getBackedgeTakenCount(&loop);
+  if (!latch || isa<SCEVCouldNotCompute>(backedgeTaken)) {
+    return false;
+  }
+
+  auto *indexTy = scalarEvolution.getEffectiveSCEVType(ptrSCEV->getType());
+  auto *lastIteration =
+      scalarEvolution.getTruncateOrZeroExtend(backedgeTaken, indexTy);
+
+  // Determine the last iteration in which the access is executed.
+  auto *block = target.getLocation()->getParent();
+  SmallVector<BasicBlock *, 4> exitingBlocks;
+  loop.getExitingBlocks(exitingBlocks);
+  bool executedInEachIteration =
+      domTree.dominates(block, latch) &&
+      llvm::all_of(exitingBlocks, [&](BasicBlock *exiting) {
+        return domTree.dominates(block, exiting);
+      });
+
+  if (executedInEachIteration) {
+    guard = nullptr;
+  } else if (loop.getExitingBlock() == loop.getHeader() &&
+             block != loop.getHeader() && domTree.dominates(block, latch)) {
+    // The loop is left from the header in the last iteration, before the
+    // access is executed. If no backedge is taken, there is no access at all.
+    guard = backedgeTaken;
+    lastIteration = scalarEvolution.getMinusSCEV(
+        lastIteration, scalarEvolution.getOne(indexTy));
+  } else {
+    return false;
+  }
+
+  auto *start = ptrSCEV->getStart();
+  auto *stride = scalarEvolution.getTruncateOrSignExtend(step, indexTy);
+  auto *last = scalarEvolution.getAddExpr(
+      start, scalarEvolution.getMulExpr(lastIteration, stride));
+  auto *size = scalarEvolution.getConstant(indexTy, target.getAccessSize());
+
+  if (step->getAPInt().isNegative()) {
+    low = last;
+    high = scalarEvolution.getAddExpr(start, size);
+  } else {
+    low = start;
+    high = scalarEvolution.getAddExpr(last, size);
+  }
+
+  // The computation of the bounds of the range is unchecked, a range whose
+  // end overflowed would look small and pass the bounds comparison.
+  mayWrap = !scalarEvolution.isKnownPredicate(ICmpInst::ICMP_UGE, high, low);
+  return true;
+}
+
+Value *LoopRangeCheckPass::createRangeViolation(IRBuilder<> &builder,
+                                                Value *low, Value *high,
+                                                Value *tripGuard,
+                                                const Witness &witness,
+                                                bool checkUpper,
+                                                bool checkLower,
+                                                bool checkWrap) {
+  auto *I64Ty = builder.getInt64Ty();
+
+  Value *violation = builder.getFalse();
+  if (checkWrap) {
+    violation = builder.CreateICmpULT(builder.CreatePtrToInt(high, I64Ty),
+                                      builder.CreatePtrToInt(low, I64Ty));
+  }
+  if (checkLower) {
+    auto *lowInt = builder.CreatePtrToInt(low, I64Ty);
+    auto *lower = builder.CreatePtrToInt(witness.getLowerBound(), I64Ty);
+    violation =
+        builder.CreateOr(violation, builder.CreateICmpULT(lowInt, lower));
+  }
+  if (checkUpper) {
+    auto *highInt = builder.CreatePtrToInt(high, I64Ty);
+    auto *upper = builder.CreatePtrToInt(witness.getUpperBound(), I64Ty);
+    violation =
+        builder.CreateOr(violation, builder.CreateICmpUGT(highInt, upper));
+  }
+
+  // The select makes sure that the range is not inspected if it is empty.
+  if (tripGuard) {
+    auto *nonEmpty = builder.CreateICmpNE(
+        tripGuard, Constant::getNullValue(tripGuard->getType()));
+    violation = builder.CreateSelect(nonEmpty, violation, builder.getFalse());
+  }
+  return violation;
+}
+
+bool LoopRangeCheckPass::transfersExecution(const Loop &loop) {
+  for (auto *block : loop.blocks()) {
+    for (auto &inst : *block) {
+      if (!isGuaranteedToTransferExecutionToSuccessor(&inst)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
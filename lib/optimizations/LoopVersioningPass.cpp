@@ -0,0 +1,385 @@
+//===- LoopVersioningPass.cpp - Unchecked Loop Versions -------------------===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/optimizations/LoopVersioningPass.h"
+
+#include "meminstrument/optimizations/LoopRangeCheckPass.h"
+#include "meminstrument/pass/Witness.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include "meminstrument/pass/Util.h"
+
+using namespace llvm;
+using namespace meminstrument;
+
+STATISTIC(NumLoopsVersioned,
+          "The # of loops versioned with an unchecked fast path");
+
+STATISTIC(NumITargetsVersioned,
+          "The # of instrumentation targets skipped on the fast path of "
+          "versioned loops");
+
+namespace {
+
+/// Ranges accessed in a loop are identified by their bounds and the guard
+/// that tells whether the range is accessed at all.
+using RangeKey =
+    std::pair<std::pair<const SCEV *, const SCEV *>, const SCEV *>;
+
+/// Information collected for a range before its code is expanded.
+struct RangeInfo {
+  Value *base = nullptr;
+  bool checkUpper = false;
+  bool checkLower = false;
+  bool checkWrap = false;
+};
+
+/// Determine the range accessed by \p target in \p loop. In addition to the
+/// strided accesses handled by the loop range checks, accesses to loop
+/// invariant addresses are summarized. The range is only used to select the
+/// loop version, so it may cover more than the loop actually accesses. A
+/// range that wraps around would select the unchecked clone, so \p mayWrap is
+/// set unless the range is known not to wrap, see
+/// LoopRangeCheckPass::computeAccessedRange.
+bool computeRange(const ConstSizeCheckIT &target, const Loop &loop,
+                  const DominatorTree &domTree,
+                  ScalarEvolution &scalarEvolution, const SCEV *&low,
+                  const SCEV *&high, const SCEV *&guard, bool &mayWrap) {
+  auto *ptrSCEV = scalarEvolution.getSCEV(target.getInstrumentee());
+  if (scalarEvolution.isLoopInvariant(ptrSCEV, &loop)) {
+    auto *indexTy = scalarEvolution.getEffectiveSCEVType(ptrSCEV->getType());
+    low = ptrSCEV;
+    high = scalarEvolution.getAddExpr(
+        ptrSCEV, scalarEvolution.getConstant(indexTy, target.getAccessSize()));
+    guard = nullptr;
+    mayWrap =
+        !scalarEvolution.isKnownPredicate(ICmpInst::ICMP_UGE, high, low);
+    return true;
+  }
+  return LoopRangeCheckPass::computeAccessedRange(
+      target, loop, domTree, scalarEvolution, low, high, guard, mayWrap);
+}
+
+} // namespace
+
+//===--------------------------- ModulePass -------------------------------===//
+
+char LoopVersioningPass::ID = 0;
+
+LoopVersioningPass::LoopVersioningPass() : ModulePass(ID) {}
+
+bool LoopVersioningPass::runOnModule(Module &) {
+  LLVM_DEBUG(dbgs() << "Running Loop Versioning Pass\n";);
+  return false;
+}
+
+void LoopVersioningPass::getAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  analysisUsage.setPreservesAll();
+}
+
+bool LoopVersioningPass::doFinalization(Module &) {
+  WorkList.clear();
+  return false;
+}
+
+void LoopVersioningPass::print(raw_ostream &stream,
+                               const Module *module) const {
+  stream << "Running Loop Versioning Pass on\n" << *module << "\n";
+}
+
+//===--------------------- OptimizationInterface --------------------------===//
+
+void LoopVersioningPass::updateITargetsForFunction(MemInstrumentPass &mip,
+                                                   ITargetVector &targets,
+                                                   Function &fun) {
+
+  auto &loopInfo = mip.getAnalysis<LoopInfoWrapperPass>(fun).getLoopInfo();
+  if (loopInfo.empty()) {
+    return;
+  }
+  auto &domTree = mip.getAnalysis<DominatorTreeWrapperPass>(fun).getDomTree();
+  auto &scalarEvolution =
+      mip.getAnalysis<ScalarEvolutionWrapperPass>(fun).getSE();
+
+  // The clone of a loop is not instrumented at all, so only loops in which
+  // every target is a spatial check can be versioned.
+  MapVector<Loop *, SmallVector<ConstSizeCheckIT *, 8>> loopChecks;
+  SmallPtrSet<const Loop *, 8> rejected;
+  for (auto &target : targets) {
+    if (!target->isValid()) {
+      continue;
+    }
+    auto *loop = loopInfo.getLoopFor(target->getLocation()->getParent());
+    if (!loop) {
+      continue;
+    }
+    auto *constSizeTarget = dyn_cast<ConstSizeCheckIT>(target);
+    if (!constSizeTarget || target->hasTemporalFlag()) {
+      rejected.insert(loop);
+      continue;
+    }
+    loopChecks[loop].push_back(constSizeTarget);
+  }
+
+  // Compute and expand the ranges of all loops before the first loop is
+  // cloned, the analyses are not kept up to date for the new blocks.
+  SmallVector<std::pair<Loop *, VersionedLoop>, 2> versions;
+  SmallVector<SmallVector<Value *, 4>, 2> versionBases;
+  SCEVExpander expander(scalarEvolution, fun.getParent()->getDataLayout(),
+                        "mi_version");
+  for (const auto &entry : loopChecks) {
+    auto *loop = entry.first;
+    if (rejected.count(loop) || !isVersionable(*loop)) {
+      continue;
+    }
+
+    auto *location = loop->getLoopPreheader()->getTerminator();
+    MapVector<RangeKey, RangeInfo> ranges;
+    bool summarized = llvm::all_of(entry.second, [&](ConstSizeCheckIT *target) {
+      const SCEV *low = nullptr;
+      const SCEV *high = nullptr;
+      const SCEV *guard = nullptr;
+      bool mayWrap = false;
+      if (!computeRange(*target, *loop, domTree, scalarEvolution, low, high,
+                        guard, mayWrap)) {
+        return false;
+      }
+
+      // The bounds of the range are those of the pointer the access is based
+      // on, which has to be available in the preheader.
+      auto *baseSCEV =
+          dyn_cast<SCEVUnknown>(scalarEvolution.getPointerBase(low));
+      if (!baseSCEV) {
+        return false;
+      }
+      auto *base = baseSCEV->getValue();
+      if (auto *baseInst = dyn_cast<Instruction>(base)) {
+        if (!domTree.dominates(baseInst, location)) {
+          return false;
+        }
+      }
+      if (!isSafeToExpandAt(low, location, scalarEvolution) ||
+          !isSafeToExpandAt(high, location, scalarEvolution) ||
+          (guard && !isSafeToExpandAt(guard, location, scalarEvolution))) {
+        return false;
+      }
+
+      auto &range = ranges[{{low, high}, guard}];
+      range.base = base;
+      range.checkUpper |= target->hasUpperBoundFlag();
+      range.checkLower |= target->hasLowerBoundFlag();
+      range.checkWrap |= mayWrap;
+      return true;
+    });
+    if (!summarized) {
+      continue;
+    }
+
+    VersionedLoop versioned;
+    SmallVector<Value *, 4> bases;
+    for (const auto &rangeEntry : ranges) {
+      VersionRange range;
+      range.low = expander.expandCodeFor(rangeEntry.first.first.first,
+                                         nullptr, location);
+      range.high = expander.expandCodeFor(rangeEntry.first.first.second,
+                                          nullptr, location);
+      if (auto *guard = rangeEntry.first.second) {
+        range.tripGuard = expander.expandCodeFor(guard, nullptr, location);
+      }
+      range.checkUpper = rangeEntry.second.checkUpper;
+      range.checkLower = rangeEntry.second.checkLower;
+      range.checkWrap = rangeEntry.second.checkWrap;
+      versioned.ranges.push_back(range);
+      bases.push_back(rangeEntry.second.base);
+    }
+    versions.push_back({loop, versioned});
+    versionBases.push_back(bases);
+
+    LLVM_DEBUG(dbgs() << "Versioning loop " << loop->getHeader()->getName()
+                      << " with " << ranges.size() << " range checks\n";);
+
+    NumITargetsVersioned += entry.second.size();
+  }
+
+  if (versions.empty()) {
+    return;
+  }
+
+  // The targets in the original loops remain valid, they are the fallback if
+  // the range checks fail. The bounds for the range checks are requested at
+  // the versioning branch.
+  auto &currentWL = WorkList[&fun];
+  for (unsigned i = 0; i < versions.size(); ++i) {
+    auto &versioned = versions[i].second;
+    versioned.branch = versionLoop(*versions[i].first, loopInfo, domTree);
+    for (unsigned j = 0; j < versioned.ranges.size(); ++j) {
+      auto &range = versioned.ranges[j];
+      range.boundsTarget = ITargetBuilder::createBoundsTarget(
+          versionBases[i][j], versioned.branch, range.checkUpper,
+          range.checkLower);
+      targets.push_back(range.boundsTarget);
+    }
+    currentWL.push_back(versioned);
+    ++NumLoopsVersioned;
+  }
+
+  LLVM_DEBUG(dbgs() << "number of remaining valid targets: "
+                    << ITargetBuilder::getNumValidITargets(targets) << "\n";);
+}
+
+void LoopVersioningPass::materializeExternalChecksForFunction(
+    MemInstrumentPass &, ITargetVector &, Function &fun) {
+  auto &ctx = fun.getContext();
+  auto *unlikely = MDBuilder(ctx).createBranchWeights(1, (1U << 20) - 1);
+
+  for (auto &versioned : WorkList[&fun]) {
+    IRBuilder<> builder(versioned.branch);
+
+    Value *violation = builder.getFalse();
+    for (auto &range : versioned.ranges) {
+      auto witness = range.boundsTarget->getSingleBoundWitness();
+      violation = builder.CreateOr(
+          violation,
+          LoopRangeCheckPass::createRangeViolation(
+              builder, range.low, range.high, range.tripGuard, *witness,
+              range.checkUpper, range.checkLower, range.checkWrap));
+      range.boundsTarget->invalidate();
+    }
+
+    versioned.branch->setCondition(violation);
+    versioned.branch->setMetadata(LLVMContext::MD_prof, unlikely);
+  }
+}
+
+//===---------------------------- private ---------------------------------===//
+
+bool LoopVersioningPass::isVersionable(const Loop &loop) {
+  auto *preheader = loop.getLoopPreheader();
+  if (!loop.getSubLoops().empty() || !preheader ||
+      !isa<BranchInst>(preheader->getTerminator()) ||
+      !loop.getUniqueExitBlock() || !loop.hasDedicatedExits() ||
+      !loop.isSafeToClone()) {
+    return false;
+  }
+
+  // Values defined in the loop are merged with their clones for uses outside
+  // of the loop. Pointers would require witnesses for the clones, which are
+  // not instrumented, so loops that leak pointers are not versioned.
+  for (auto *block : loop.blocks()) {
+    for (auto &inst : *block) {
+      auto *type = inst.getType();
+      if (type->isIntOrIntVectorTy() || type->isFPOrFPVectorTy()) {
+        continue;
+      }
+      if (llvm::any_of(inst.users(), [&](const User *user) {
+            return !loop.contains(cast<Instruction>(user));
+          })) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+BranchInst *LoopVersioningPass::versionLoop(Loop &loop, LoopInfo &loopInfo,
+                                            DominatorTree &domTree) {
+  auto *preheader = loop.getLoopPreheader();
+  auto *header = loop.getHeader();
+  auto *exitBlock = loop.getUniqueExitBlock();
+  auto &ctx = header->getContext();
+
+  // Collect the uses of loop values outside of the loop before the clone adds
+  // new ones. Uses in phis of the exit block are updated separately.
+  SmallVector<Use *, 8> outsideUses;
+  for (auto *block : loop.blocks()) {
+    for (auto &inst : *block) {
+      for (auto &use : inst.uses()) {
+        auto *user = cast<Instruction>(use.getUser());
+        if (loop.contains(user) ||
+            (isa<PHINode>(user) && user->getParent() == exitBlock)) {
+          continue;
+        }
+        outsideUses.push_back(&use);
+      }
+    }
+  }
+
+  // The versioning branch gets a block of its own behind the preheader, such
+  // that targets that are placed in the preheader are checked in both
+  // versions.
+  auto *checkBlock = BasicBlock::Create(ctx, header->getName() + ".mi_version",
+                                        header->getParent(), header);
+  BranchInst::Create(header, checkBlock);
+  preheader->getTerminator()->replaceUsesOfWith(header, checkBlock);
+  header->replacePhiUsesWith(preheader, checkBlock);
+  if (auto *parentLoop = loop.getParentLoop()) {
+    parentLoop->addBasicBlockToLoop(checkBlock, loopInfo);
+  }
+  domTree.addNewBlock(checkBlock, preheader);
+  domTree.changeImmediateDominator(header, checkBlock);
+
+  auto *loopPreheader =
+      SplitBlock(checkBlock, checkBlock->getTerminator(), &domTree, &loopInfo,
+                 nullptr, header->getName() + ".mi_ph");
+
+  ValueToValueMapTy valueMap;
+  SmallVector<BasicBlock *, 8> fastBlocks;
+  cloneLoopWithPreheader(loopPreheader, checkBlock, &loop, valueMap, ".mi_fast",
+                         &loopInfo, &domTree, fastBlocks);
+  remapInstructionsInBlocks(fastBlocks, valueMap);
+  auto *fastPreheader = cast<BasicBlock>(valueMap[loopPreheader]);
+
+  // Until the range checks are materialized, the instrumented loop is taken.
+  auto *branch = BranchInst::Create(loopPreheader, fastPreheader,
+                                    ConstantInt::getTrue(ctx));
+  ReplaceInstWithInst(checkBlock->getTerminator(), branch);
+
+  // Both versions leave through the exit block.
+  for (auto &phi : exitBlock->phis()) {
+    for (unsigned i = 0, e = phi.getNumIncomingValues(); i < e; ++i) {
+      Value *incoming = phi.getIncomingValue(i);
+      if (Value *mapped = valueMap.lookup(incoming)) {
+        incoming = mapped;
+      }
+      phi.addIncoming(incoming,
+                      cast<BasicBlock>(valueMap[phi.getIncomingBlock(i)]));
+    }
+  }
+
+  DenseMap<Value *, PHINode *> mergedValues;
+  for (auto *use : outsideUses) {
+    auto *inst = use->get();
+    auto &merged = mergedValues[inst];
+    if (!merged) {
+      merged = PHINode::Create(inst->getType(), 0,
+                               inst->getName() + ".mi_merge",
+                               &exitBlock->front());
+      for (auto *pred : predecessors(exitBlock)) {
+        Value *incoming = inst;
+        if (!loop.contains(pred)) {
+          incoming = valueMap[inst];
+        }
+        merged->addIncoming(incoming, pred);
+      }
+    }
+    use->set(merged);
+  }
+
+  domTree.changeImmediateDominator(exitBlock, checkBlock);
+  return branch;
+}
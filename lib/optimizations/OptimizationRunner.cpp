@@ -8,17 +8,26 @@
 
 #include "meminstrument/Definitions.h"
 #include "meminstrument/optimizations/AnnotationBasedRemovalPass.h"
+#include "meminstrument/optimizations/AvailableChecksPass.h"
+#include "meminstrument/optimizations/CheckCoalescingPass.h"
 #include "meminstrument/optimizations/DominanceBasedCheckRemovalPass.h"
+#include "meminstrument/optimizations/EarlyArgumentCheckPass.h"
 #include "meminstrument/optimizations/ExampleExternalChecksPass.h"
 #include "meminstrument/optimizations/HotnessBasedCheckRemovalPass.h"
+#include "meminstrument/optimizations/LoopInvariantCheckHoistingPass.h"
+#include "meminstrument/optimizations/LoopRangeCheckPass.h"
+#include "meminstrument/optimizations/LoopVersioningPass.h"
+#include "meminstrument/optimizations/StaticBoundsCheckRemovalPass.h"
 #include "meminstrument/pass/Util.h"
 
 #if PICO_AVAILABLE
 #include "PICO/PICO.h"
 #include "PMDA/PMDA.h"
-#include "llvm/Analysis/ScalarEvolution.h"
 #endif
 
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
@@ -32,10 +41,24 @@ cl::list<InstrumentationOptimizations> OptimizationList(
                           "Annotation based filter"),
                clEnumValN(dominance_checkrem, "mi-opt-dominance",
                           "Dominance based filter"),
+               clEnumValN(available_checkrem, "mi-opt-available",
+                          "Available checks based filter"),
                clEnumValN(hotness_checkrem, "mi-opt-hotness",
                           "Hotness based filter"),
+               clEnumValN(staticbounds_checkrem, "mi-opt-static-bounds",
+                          "Static in-bounds proofs filter"),
                clEnumValN(example_checkopt, "mi-opt-example",
                           "Example external checks"),
+               clEnumValN(licm_checkopt, "mi-opt-licm",
+                          "Loop invariant check hoisting"),
+               clEnumValN(looprange_checkopt, "mi-opt-loop-range",
+                          "Range checks for strided loop accesses"),
+               clEnumValN(loopversion_checkopt, "mi-opt-loop-versioning",
+                          "Unchecked loop versions behind range checks"),
+               clEnumValN(coalesce_checkopt, "mi-opt-coalesce",
+                          "Coalescing of constant offset checks"),
+               clEnumValN(earlyarg_checkopt, "mi-opt-early-args",
+                          "Check arguments at the function entry"),
                clEnumValN(pico_checkopt, "mi-opt-pico", "PICO")));
 
 OptimizationRunner::OptimizationRunner(MemInstrumentPass &mip)
@@ -88,14 +111,43 @@ void OptimizationRunner::addRequiredAnalyses(AnalysisUsage &analysisUsage) {
       analysisUsage.addRequired<AnnotationBasedRemovalPass>();
       break;
     case InstrumentationOptimizations::dominance_checkrem:
+      analysisUsage.addRequired<ScalarEvolutionWrapperPass>();
       analysisUsage.addRequired<DominanceBasedCheckRemovalPass>();
       break;
+    case InstrumentationOptimizations::available_checkrem:
+      analysisUsage.addRequired<ScalarEvolutionWrapperPass>();
+      analysisUsage.addRequired<AvailableChecksPass>();
+      break;
     case InstrumentationOptimizations::hotness_checkrem:
       analysisUsage.addRequired<HotnessBasedCheckRemovalPass>();
       break;
+    case InstrumentationOptimizations::staticbounds_checkrem:
+      analysisUsage.addRequired<StaticBoundsCheckRemovalPass>();
+      break;
     case InstrumentationOptimizations::example_checkopt:
       analysisUsage.addRequired<ExampleExternalChecksPass>();
       break;
+    case InstrumentationOptimizations::licm_checkopt:
+      analysisUsage.addRequired<LoopInfoWrapperPass>();
+      analysisUsage.addRequired<LoopInvariantCheckHoistingPass>();
+      break;
+    case InstrumentationOptimizations::looprange_checkopt:
+      analysisUsage.addRequired<LoopInfoWrapperPass>();
+      analysisUsage.addRequired<ScalarEvolutionWrapperPass>();
+      analysisUsage.addRequired<LoopRangeCheckPass>();
+      break;
+    case InstrumentationOptimizations::loopversion_checkopt:
+      analysisUsage.addRequired<LoopInfoWrapperPass>();
+      analysisUsage.addRequired<ScalarEvolutionWrapperPass>();
+      analysisUsage.addRequired<LoopVersioningPass>();
+      break;
+    case InstrumentationOptimizations::coalesce_checkopt:
+      analysisUsage.addRequired<CheckCoalescingPass>();
+      break;
+    case InstrumentationOptimizations::earlyarg_checkopt:
+      analysisUsage.addRequired<PostDominatorTreeWrapperPass>();
+      analysisUsage.addRequired<EarlyArgumentCheckPass>();
+      break;
     case InstrumentationOptimizations::pico_checkopt:
 #if !PICO_AVAILABLE
       MemInstrumentError::report("PICO selected but not available.");
@@ -131,12 +183,33 @@ auto OptimizationRunner::computeSelectedOpts(MemInstrumentPass &mi)
     case InstrumentationOptimizations::dominance_checkrem:
       opts.push_back(&mi.getAnalysis<DominanceBasedCheckRemovalPass>());
       break;
+    case InstrumentationOptimizations::available_checkrem:
+      opts.push_back(&mi.getAnalysis<AvailableChecksPass>());
+      break;
     case InstrumentationOptimizations::hotness_checkrem:
       opts.push_back(&mi.getAnalysis<HotnessBasedCheckRemovalPass>());
       break;
+    case InstrumentationOptimizations::staticbounds_checkrem:
+      opts.push_back(&mi.getAnalysis<StaticBoundsCheckRemovalPass>());
+      break;
     case InstrumentationOptimizations::example_checkopt:
       opts.push_back(&mi.getAnalysis<ExampleExternalChecksPass>());
       break;
+    case InstrumentationOptimizations::licm_checkopt:
+      opts.push_back(&mi.getAnalysis<LoopInvariantCheckHoistingPass>());
+      break;
+    case InstrumentationOptimizations::looprange_checkopt:
+      opts.push_back(&mi.getAnalysis<LoopRangeCheckPass>());
+      break;
+    case InstrumentationOptimizations::loopversion_checkopt:
+      opts.push_back(&mi.getAnalysis<LoopVersioningPass>());
+      break;
+    case InstrumentationOptimizations::coalesce_checkopt:
+      opts.push_back(&mi.getAnalysis<CheckCoalescingPass>());
+      break;
+    case InstrumentationOptimizations::earlyarg_checkopt:
+      opts.push_back(&mi.getAnalysis<EarlyArgumentCheckPass>());
+      break;
     case InstrumentationOptimizations::pico_checkopt:
 #if !PICO_AVAILABLE
       MemInstrumentError::report("PICO selected but not available.");
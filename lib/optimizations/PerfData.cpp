@@ -10,13 +10,23 @@
 #include "meminstrument/Definitions.h"
 #include "meminstrument/pass/Util.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
 STATISTIC(FailingHotnessLookUps, "The # of failing hotness lookups");
 
+STATISTIC(LoadedProfileEntries, "The # of loaded profile entries");
+
 using namespace meminstrument;
 using namespace llvm;
 
@@ -24,10 +34,103 @@ namespace {
 
 cl::opt<std::string>
     DBPathOpt("mi-profile-db-path",
-              cl::desc("path to a meminstrument profile database"),
+              cl::desc("path to a meminstrument profile database or binary "
+                       "profile"),
               cl::init("") // default
     );
 
+/// Number of executions per function and access ID of a module.
+using ModuleProfile = StringMap<DenseMap<uint64_t, uint64_t>>;
+
+const StringRef BinaryProfileMagic("MIPROF01");
+
+/// Read the profile of the module \p moduleName from the binary profile
+/// \p data. Returns false if the profile is malformed.
+bool loadBinaryProfile(StringRef data, StringRef moduleName,
+                       ModuleProfile &profile) {
+  size_t pos = BinaryProfileMagic.size();
+
+  auto readWord = [&](uint64_t &word) {
+    if (data.size() - pos < sizeof(uint64_t)) {
+      return false;
+    }
+    word = support::endian::read64le(data.data() + pos);
+    pos += sizeof(uint64_t);
+    return true;
+  };
+  auto readName = [&](uint64_t size, StringRef &name) {
+    auto paddedSize = alignTo(size, sizeof(uint64_t));
+    if (paddedSize < size || data.size() - pos < paddedSize) {
+      return false;
+    }
+    name = data.substr(pos, size);
+    pos += paddedSize;
+    return true;
+  };
+
+  uint64_t numModules = 0;
+  if (!readWord(numModules)) {
+    return false;
+  }
+  for (uint64_t mod = 0; mod < numModules; ++mod) {
+    uint64_t nameSize = 0;
+    uint64_t numFunctions = 0;
+    StringRef name;
+    if (!readWord(nameSize) || !readWord(numFunctions) ||
+        !readName(nameSize, name)) {
+      return false;
+    }
+    bool isRequested = (name == moduleName);
+
+    for (uint64_t fun = 0; fun < numFunctions; ++fun) {
+      uint64_t numAccesses = 0;
+      StringRef funName;
+      if (!readWord(nameSize) || !readWord(numAccesses) ||
+          !readName(nameSize, funName)) {
+        return false;
+      }
+      const size_t entrySize = 2 * sizeof(uint64_t);
+      if ((data.size() - pos) / entrySize < numAccesses) {
+        return false;
+      }
+      if (isRequested) {
+        auto &accesses = profile[funName];
+        accesses.reserve(numAccesses);
+        for (uint64_t i = 0; i < numAccesses; ++i) {
+          const char *entry = data.data() + pos + i * entrySize;
+          accesses[support::endian::read64le(entry)] =
+              support::endian::read64le(entry + sizeof(uint64_t));
+        }
+        LoadedProfileEntries += numAccesses;
+      }
+      pos += numAccesses * entrySize;
+    }
+
+    if (isRequested) {
+      return true;
+    }
+  }
+  return true;
+}
+
+/// Check whether the file at \p path starts with the magic of a binary
+/// profile. Only the header is read.
+bool isBinaryProfile(StringRef path) {
+  auto file = sys::fs::openNativeFileForRead(path);
+  if (!file) {
+    consumeError(file.takeError());
+    return false;
+  }
+  char magic[8];
+  auto bytesRead = sys::fs::readNativeFile(*file, magic);
+  sys::fs::closeFile(*file);
+  if (!bytesRead) {
+    consumeError(bytesRead.takeError());
+    return false;
+  }
+  return StringRef(magic, *bytesRead) == BinaryProfileMagic;
+}
+
 } // namespace
 
 #if HAS_SQLITE3
@@ -36,120 +139,147 @@ cl::opt<std::string>
 
 namespace {
 
-struct QueryResult {
-  uint64_t value;
-  bool did_something;
-};
-
-static int callback(void *data, int numCols, char **fields, char **) {
-  QueryResult *qr = (QueryResult *)data;
-  assert(numCols == 1);
-  StringRef num(fields[0]);
-  num.getAsInteger(10, qr->value);
-  qr->did_something = true;
-  return 0;
-}
-
-void queryValue(sqlite3 *db, std::string &query, QueryResult &qr) {
-  qr.value = 0;
-  qr.did_something = false;
+/// Read the profile of the module \p moduleName from the profile database.
+/// Returns false if the database cannot be read.
+bool loadDBProfile(StringRef moduleName, ModuleProfile &profile) {
+  sqlite3 *db = nullptr;
+  if (sqlite3_open_v2(DBPathOpt.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) !=
+      SQLITE_OK) {
+    ++FailingHotnessLookUps;
+    errs() << "Can't open database: " << sqlite3_errmsg(db) << "\n";
+    sqlite3_close(db);
+    return false;
+  }
 
-  char *zErrMsg = nullptr;
+  // Fetch all rows of the module at once instead of querying each access.
+  const char *query = "SELECT data.fname, data.aid, data.value FROM data "
+                      "JOIN modulenames ON data.mid == modulenames.mid "
+                      "WHERE modulenames.mname == ?1";
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) != SQLITE_OK) {
+    ++FailingHotnessLookUps;
+    errs() << "SQL error: " << sqlite3_errmsg(db) << "\n";
+    sqlite3_close(db);
+    return false;
+  }
+  sqlite3_bind_text(stmt, 1, moduleName.data(), moduleName.size(),
+                    SQLITE_TRANSIENT);
 
   int rc = 0;
-
-  rc = sqlite3_exec(db, query.c_str(), callback, &qr, &zErrMsg);
-  if (rc != SQLITE_OK) {
-    errs() << "SQL error: " << zErrMsg << "\n";
-    sqlite3_free(zErrMsg);
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    StringRef funName(
+        reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)),
+        sqlite3_column_bytes(stmt, 0));
+    auto accessId = static_cast<uint64_t>(sqlite3_column_int64(stmt, 1));
+    auto value = static_cast<uint64_t>(sqlite3_column_int64(stmt, 2));
+    profile[funName][accessId] = value;
+    ++LoadedProfileEntries;
+  }
+  bool success = (rc == SQLITE_DONE);
+  if (!success) {
+    ++FailingHotnessLookUps;
+    errs() << "SQL error: " << sqlite3_errmsg(db) << "\n";
   }
+
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  return success;
 }
 
 } // namespace
 
-namespace meminstrument {
+#else
 
-uint64_t getHotnessIndex(StringRef ModuleName, StringRef FunctionName,
-                         uint64_t AccessId) {
-  static sqlite3 *db = nullptr;
-  static bool failed = false;
+namespace {
 
-  static bool found_mid = false;
-  static uint64_t mid = 0;
+bool loadDBProfile(StringRef, ModuleProfile &) {
+  ++FailingHotnessLookUps;
+  dbgs() << "Trying to use performance data without sqlite3, this has no "
+            "results.\n";
+  return false;
+}
 
-  if (failed) {
-    return 0;
-  }
+} // namespace
 
-  int rc = 0;
+#endif
 
-  if (db == nullptr) {
-    rc = sqlite3_open(DBPathOpt.c_str(), &db);
-    if (rc) {
-      ++FailingHotnessLookUps;
-      errs() << "Can't open database: " << sqlite3_errmsg(db) << "\n";
-      failed = true;
-      return 0;
-    }
+namespace {
+
+/// Get the profile of the module \p moduleName, load it on the first request.
+const ModuleProfile &getModuleProfile(StringRef moduleName) {
+  static StringMap<ModuleProfile> profiles;
+
+  auto inserted = profiles.try_emplace(moduleName);
+  auto &profile = inserted.first->second;
+  if (!inserted.second) {
+    return profile;
   }
 
-  if (!found_mid) {
-    std::string stmt;
-    raw_string_ostream ss(stmt);
-    ss << "SELECT mid FROM modulenames"
-       << "WHERE mname==\"" << ModuleName << "\" "
-       << "LIMIT 1";
-
-    QueryResult qr;
-    queryValue(db, stmt, qr);
-
-    if (!qr.did_something) {
-      ++FailingHotnessLookUps;
-      dbgs() << "[mi_perf] Failing Module lookup: " << stmt.c_str() << "\n";
-      failed = true;
-      return 0;
+  // Binary profiles are mapped into memory, everything else is expected to be
+  // a database.
+  bool loaded = false;
+  if (isBinaryProfile(DBPathOpt)) {
+    auto fileContent = MemoryBuffer::getFile(DBPathOpt, -1, false);
+    if (!fileContent) {
+      MemInstrumentError::report("Cannot read binary profile `" + DBPathOpt +
+                                 "`.");
+    }
+    if (!loadBinaryProfile(fileContent.get()->getBuffer(), moduleName,
+                           profile)) {
+      MemInstrumentError::report("Malformed binary profile `" + DBPathOpt +
+                                 "`.");
     }
-    mid = qr.value;
-    found_mid = true;
+    loaded = true;
+  } else {
+    loaded = loadDBProfile(moduleName, profile);
   }
 
-  std::string stmt;
-  raw_string_ostream ss(stmt);
-  ss << "SELECT value FROM data "
-     << "WHERE mid==\"" << mid << "\" "
-     << "AND fname==\"" << FunctionName << "\" "
-     << "AND aid==" << AccessId << " "
-     << "LIMIT 1";
-
-  QueryResult qr;
-  queryValue(db, stmt, qr);
-
-  if (!qr.did_something) {
+  if (loaded && profile.empty()) {
     ++FailingHotnessLookUps;
-    dbgs() << "[mi_perf] Failing lookup: " << stmt.c_str() << "\n";
+    LLVM_DEBUG(dbgs() << "[mi_perf] Failing module lookup: " << moduleName
+                      << "\n";);
   }
-
-  return qr.value;
+  return profile;
 }
 
-} // namespace meminstrument
-
-#else
+} // namespace
 
 namespace meminstrument {
 
-uint64_t getHotnessIndex(StringRef, StringRef, uint64_t) {
-  ++FailingHotnessLookUps;
+uint64_t getHotnessIndex(StringRef ModuleName, StringRef FunctionName,
+                         uint64_t AccessId) {
+  const auto &profile = getModuleProfile(ModuleName);
 
-  static bool first_time = true;
-  if (first_time) {
-    dbgs() << "Trying to use performance data without sqlite3, this has no "
-              "results.\n";
+  auto funIt = profile.find(FunctionName);
+  if (funIt != profile.end()) {
+    auto it = funIt->second.find(AccessId);
+    if (it != funIt->second.end()) {
+      return it->second;
+    }
   }
 
-  first_time = false;
+  ++FailingHotnessLookUps;
+  LLVM_DEBUG(dbgs() << "[mi_perf] Failing lookup: " << FunctionName << " #"
+                    << AccessId << "\n";);
   return 0;
 }
 
+uint64_t getBlockHotness(const BasicBlock &Block, const BlockFrequencyInfo &BFI,
+                         ProfileSummaryInfo *PSI) {
+  if (PSI && PSI->hasProfileSummary()) {
+    if (auto count = BFI.getBlockProfileCount(&Block)) {
+      return *count;
+    }
+  }
+
+  const uint64_t staticEntryCount = 1024;
+  auto entryFreq = BFI.getEntryFreq();
+  if (entryFreq == 0) {
+    return 0;
+  }
+  double relativeFreq =
+      static_cast<double>(BFI.getBlockFreq(&Block).getFrequency()) / entryFreq;
+  return static_cast<uint64_t>(relativeFreq * staticEntryCount);
+}
+
 } // namespace meminstrument
-#endif
@@ -0,0 +1,98 @@
+//===- StaticBoundsCheckRemovalPass.cpp - Remove Statically Safe Checks ---===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/optimizations/StaticBoundsCheckRemovalPass.h"
+
+#include "meminstrument/pass/Util.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Constants.h"
+
+using namespace llvm;
+using namespace meminstrument;
+
+STATISTIC(NumITargetsStaticallyInBounds,
+          "The # of instrumentation targets discarded because they are "
+          "statically in bounds");
+
+//===--------------------------- ModulePass -------------------------------===//
+
+char StaticBoundsCheckRemovalPass::ID = 0;
+
+StaticBoundsCheckRemovalPass::StaticBoundsCheckRemovalPass()
+    : ModulePass(ID) {}
+
+bool StaticBoundsCheckRemovalPass::runOnModule(Module &) {
+  LLVM_DEBUG(dbgs() << "Running Static Bounds Check Removal Pass\n";);
+  return false;
+}
+
+void StaticBoundsCheckRemovalPass::getAnalysisUsage(
+    AnalysisUsage &analysisUsage) const {
+  analysisUsage.setPreservesAll();
+}
+
+void StaticBoundsCheckRemovalPass::print(raw_ostream &stream,
+                                         const Module *module) const {
+  stream << "Running Static Bounds Check Removal Pass on\n" << *module << "\n";
+}
+
+//===--------------------- OptimizationInterface --------------------------===//
+
+void StaticBoundsCheckRemovalPass::updateITargetsForFunction(
+    MemInstrumentPass &, ITargetVector &targets, Function &fun) {
+
+  const auto &dataLayout = fun.getParent()->getDataLayout();
+
+  for (auto &target : targets) {
+    if (!target->isValid() || target->hasTemporalFlag()) {
+      continue;
+    }
+    if (isStaticallyInBounds(*target, dataLayout)) {
+      LLVM_DEBUG(dbgs() << "Statically in bounds: " << *target << "\n";);
+      target->invalidate();
+      ++NumITargetsStaticallyInBounds;
+    }
+  }
+
+  LLVM_DEBUG(dbgs() << "number of remaining valid targets: "
+                    << ITargetBuilder::getNumValidITargets(targets) << "\n";);
+}
+
+//===---------------------------- private ---------------------------------===//
+
+bool StaticBoundsCheckRemovalPass::isStaticallyInBounds(
+    const ITarget &target, const DataLayout &dataLayout) const {
+
+  uint64_t accessSize = 0;
+  if (auto *constSizeTarget = dyn_cast<ConstSizeCheckIT>(&target)) {
+    accessSize = constSizeTarget->getAccessSize();
+  } else if (auto *varSizeTarget = dyn_cast<VarSizeCheckIT>(&target)) {
+    auto *sizeVal = dyn_cast<ConstantInt>(varSizeTarget->getAccessSizeVal());
+    if (!sizeVal || sizeVal->getValue().getActiveBits() > 63) {
+      return false;
+    }
+    accessSize = sizeVal->getZExtValue();
+  } else {
+    return false;
+  }
+
+  int64_t offset = 0;
+  auto *base = GetPointerBaseWithConstantOffset(target.getInstrumentee(),
+                                                offset, dataLayout);
+  uint64_t objectSize = 0;
+  if (!getStaticAllocationSize(dataLayout, base, objectSize)) {
+    return false;
+  }
+
+  // The access covers [offset, offset + accessSize) within the object
+  if (offset < 0 || static_cast<uint64_t>(offset) > objectSize) {
+    return false;
+  }
+  return accessSize <= objectSize - static_cast<uint64_t>(offset);
+}
@@ -10,14 +10,25 @@
 #include "meminstrument/Config.h"
 #include "meminstrument/instrumentation_mechanisms/InstrumentationMechanism.h"
 
-#include "meminstrument/pass/Util.h"
-
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+#include "meminstrument/pass/Util.h"
+
+#include <algorithm>
 
 using namespace meminstrument;
 using namespace llvm;
 
+STATISTIC(NumSampledChecks, "The # of checks guarded by a sampling countdown");
+STATISTIC(NumPatchableChecks,
+          "The # of checks that can be disabled individually at run time");
+
 static cl::opt<bool> NoInvariantChecks(
     "mi-no-invariant-checks",
     cl::desc("Don't place checks for invariants (this will horribly break e.g. "
@@ -25,6 +36,225 @@ static cl::opt<bool> NoInvariantChecks(
              "so make sure you know what you do)"),
     cl::init(false));
 
+static cl::opt<unsigned> SamplePeriod(
+    "mi-sample-checks",
+    cl::desc("Only run every Nth check of each thread, the period can be "
+             "overridden at startup with the MI_SAMPLE_PERIOD environment "
+             "variable (0 and 1 run every check)"),
+    cl::init(0));
+
+static cl::opt<bool> PatchableChecks(
+    "mi-patchable-checks",
+    cl::desc("Guard each check by an enable flag of its site that the run "
+             "time can clear to disable the site"),
+    cl::init(false));
+
+namespace {
+
+/// The per-module state of the check sampling: a thread-local countdown to
+/// the next sampled check and the period it is reset to after each sample.
+struct SamplingState {
+  GlobalVariable *countdown;
+  GlobalVariable *period;
+};
+
+/// Create a module constructor that overrides the sampling period with the
+/// value of the MI_SAMPLE_PERIOD environment variable, if it is set to a
+/// positive number.
+void insertSamplePeriodSetup(Module &M, GlobalVariable *period) {
+  auto &Ctx = M.getContext();
+  auto *I64Ty = Type::getInt64Ty(Ctx);
+  auto *StringTy = Type::getInt8PtrTy(Ctx);
+
+  auto StrToULLFun = M.getOrInsertFunction(
+      "strtoull", I64Ty, StringTy, PointerType::getUnqual(StringTy),
+      Type::getInt32Ty(Ctx));
+
+  Value *Env = nullptr;
+  auto *Parse = InstrumentationMechanism::insertSetupCtor(
+      M, "__mi_sample_setup", "MI_SAMPLE_PERIOD", Env);
+
+  IRBuilder<> Builder(Parse->getTerminator());
+  auto *NewPeriod = Builder.CreateCall(
+      StrToULLFun, {Env, ConstantPointerNull::get(PointerType::getUnqual(
+                             StringTy)),
+                    Builder.getInt32(10)});
+  Builder.SetInsertPoint(SplitBlockAndInsertIfThen(
+      Builder.CreateIsNotNull(NewPeriod), Parse->getTerminator(), false));
+  setNoInstrument(Builder.CreateStore(NewPeriod, period));
+}
+
+SamplingState getSamplingState(Module &M) {
+  if (auto *countdown = M.getNamedGlobal("__mi_sample_countdown")) {
+    return {countdown, M.getNamedGlobal("__mi_sample_period")};
+  }
+
+  auto *I64Ty = Type::getInt64Ty(M.getContext());
+  // Every thread samples its first check and continues with the period
+  // that is in effect at that point.
+  auto *countdown = new GlobalVariable(
+      M, I64Ty, false, GlobalValue::InternalLinkage,
+      ConstantInt::get(I64Ty, 1), "__mi_sample_countdown", nullptr,
+      GlobalValue::GeneralDynamicTLSModel);
+  setNoInstrument(countdown);
+  auto *period = new GlobalVariable(
+      M, I64Ty, false, GlobalValue::InternalLinkage,
+      ConstantInt::get(I64Ty, SamplePeriod), "__mi_sample_period");
+  setNoInstrument(period);
+
+  insertSamplePeriodSetup(M, period);
+  return {countdown, period};
+}
+
+/// Emit the sampling countdown update in front of \p Builder's insertion point
+/// and return whether this execution is sampled. The unsampled path only
+/// decrements the countdown, see emitSampleReset for the sampled one.
+Value *emitSampleGuard(IRBuilder<> &Builder, Module &M) {
+  auto state = getSamplingState(M);
+  auto *I64Ty = Type::getInt64Ty(M.getContext());
+
+  auto *count =
+      Builder.CreateLoad(I64Ty, state.countdown, "mi_sample_countdown");
+  auto *next = Builder.CreateSub(count, ConstantInt::get(I64Ty, 1));
+  auto *store = Builder.CreateStore(next, state.countdown);
+  setNoInstrument(count);
+  setNoInstrument(store);
+  return Builder.CreateICmpEQ(next, ConstantInt::get(I64Ty, 0), "mi_sample");
+}
+
+/// Emit the reset of the sampling countdown to the current period in front of
+/// \p Builder's insertion point. Only sampled executions reach it.
+void emitSampleReset(IRBuilder<> &Builder, Module &M) {
+  auto state = getSamplingState(M);
+  auto *I64Ty = Type::getInt64Ty(M.getContext());
+
+  auto *period = Builder.CreateLoad(I64Ty, state.period, "mi_sample_period");
+  auto *store = Builder.CreateStore(period, state.countdown);
+  setNoInstrument(period);
+  setNoInstrument(store);
+}
+
+/// Return the name of \p M as a string literal that the site entries of the
+/// module share.
+GlobalVariable *getSiteModuleName(Module &M) {
+  if (auto *name = M.getNamedGlobal("__mi_site_module")) {
+    return name;
+  }
+  auto *name = InstrumentationMechanism::insertStringLiteral(M, M.getName());
+  name->setName("__mi_site_module");
+  name->setConstant(true);
+  return name;
+}
+
+/// Create the entry for a patchable check site in the `mi_sites` section and
+/// return whether the site is currently enabled.
+Value *emitSiteGuard(IRBuilder<> &Builder, Module &M, uint64_t id) {
+  auto &Ctx = M.getContext();
+  auto *I64Ty = Type::getInt64Ty(Ctx);
+  auto *I8Ty = Type::getInt8Ty(Ctx);
+  auto *StringTy = Type::getInt8PtrTy(Ctx);
+
+  auto *SiteTy = StructType::get(I64Ty, StringTy, I8Ty);
+  auto *site = new GlobalVariable(
+      M, SiteTy, false, GlobalValue::InternalLinkage,
+      ConstantStruct::get(
+          SiteTy, ConstantInt::get(I64Ty, id),
+          ConstantExpr::getPointerCast(getSiteModuleName(M), StringTy),
+          ConstantInt::get(I8Ty, 1)),
+      "__mi_site");
+  site->setSection("mi_sites");
+  site->setAlignment(Align(8));
+  setNoInstrument(site);
+  appendToCompilerUsed(M, {site});
+
+  auto *flag = Builder.CreateConstInBoundsGEP2_32(SiteTy, site, 0, 2);
+  auto *enabled = Builder.CreateLoad(I8Ty, flag, "mi_site_enabled");
+  enabled->setAtomic(AtomicOrdering::Monotonic);
+  enabled->setAlignment(Align(1));
+  setNoInstrument(enabled);
+  ++NumPatchableChecks;
+  return Builder.CreateIsNotNull(enabled);
+}
+
+/// Insert the check for the target and make it conditional on the sampling
+/// countdown of the executing thread and/or the enable flag of its site. The
+/// skipping path takes a well predictable branch around the check code.
+void insertGuardedCheck(InstrumentationMechanism &IM, ITarget &T) {
+  auto *location = T.getLocation();
+  auto *block = location->getParent();
+  auto *prev = location->getPrevNode();
+  SmallVector<Value *, 4> operands(location->operands());
+
+  IM.insertCheck(T);
+
+  // The check code is everything between the previous instruction and the
+  // location, the mechanism might have split the block in between. A check
+  // that rewrote the operands of the location (see -mi-branchless-checks) is
+  // used by the location and cannot be skipped.
+  auto *start = prev ? prev->getNextNode() : &block->front();
+  if (start == location ||
+      !std::equal(operands.begin(), operands.end(),
+                  location->op_begin())) {
+    return;
+  }
+
+  auto *checkBlock = SplitBlock(block, start, (DominatorTree *)nullptr,
+                                nullptr, nullptr, "mi_guarded");
+  auto *contBlock = SplitBlock(location->getParent(), location,
+                               (DominatorTree *)nullptr, nullptr, nullptr,
+                               "mi_guarded_cont");
+
+  auto &M = *block->getModule();
+  auto *term = block->getTerminator();
+  bool patchable = PatchableChecks && hasAccessID(location);
+  IRBuilder<> Builder(term);
+  if (SamplePeriod > 1) {
+    // A sampled execution resets the countdown even if its site is disabled,
+    // so the reset cannot be part of the guarded check code then.
+    auto *sampledBlock = checkBlock;
+    if (patchable) {
+      sampledBlock = BasicBlock::Create(M.getContext(), "mi_sampled",
+                                        block->getParent(), checkBlock);
+    }
+    auto *sample = emitSampleGuard(Builder, M);
+    auto *weights = MDBuilder(M.getContext())
+                        .createBranchWeights(1, SamplePeriod - 1);
+    Builder.CreateCondBr(sample, sampledBlock, contBlock, weights);
+    if (patchable) {
+      Builder.SetInsertPoint(sampledBlock);
+    } else {
+      Builder.SetInsertPoint(&checkBlock->front());
+    }
+    emitSampleReset(Builder, M);
+    ++NumSampledChecks;
+  }
+  if (patchable) {
+    auto *enabled = emitSiteGuard(Builder, M, getAccessID(location));
+    Builder.CreateCondBr(enabled, checkBlock, contBlock);
+  }
+  term->eraseFromParent();
+}
+
+/// Insert the check for the target, guarded if requested.
+void insertCheck(InstrumentationMechanism &IM, ITarget &T) {
+  if (SamplePeriod > 1 ||
+      (PatchableChecks && hasAccessID(T.getLocation()))) {
+    if (InstrumentationMechanism::hasDeferredChecks()) {
+      // The fail branch would be placed outside of the guarded code
+      MemInstrumentError::report(
+          "Deferred checks cannot be combined with sampled or patchable "
+          "checks.");
+    }
+    insertGuardedCheck(IM, T);
+  } else {
+    IM.insertCheck(T);
+  }
+}
+
+} // namespace
+
+bool meminstrument::isPatchableChecksEnabled() { return PatchableChecks; }
+
 void meminstrument::generateInvariants(GlobalConfig &CFG, ITargetVector &Vec,
                                        Function &F) {
 
@@ -37,7 +267,13 @@ void meminstrument::generateInvariants(GlobalConfig &CFG, ITargetVector &Vec,
   for (auto &T : Vec) {
     if (T->isValid()) {
       if (T->isInvariant()) {
-        IM.insertCheck(*T);
+        // Invariants that are not checks maintain metadata (e.g. SoftBound's
+        // shadow stack), they have to be executed every time.
+        if (IM.invariantsAreChecks()) {
+          insertCheck(IM, *T);
+        } else {
+          IM.insertCheck(*T);
+        }
       }
     }
   }
@@ -50,7 +286,7 @@ void meminstrument::generateChecks(GlobalConfig &CFG, ITargetVector &Vec,
   for (auto &T : Vec) {
     if (T->isValid()) {
       if (T->isCheck()) {
-        IM.insertCheck(*T);
+        insertCheck(IM, *T);
       }
     }
   }
@@ -0,0 +1,149 @@
+//===- CheckProfiler.cpp - Profile Check Sites ----------------------------===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/pass/CheckProfiler.h"
+
+#include "meminstrument/instrumentation_mechanisms/InstrumentationMechanism.h"
+#include "meminstrument/pass/Util.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace meminstrument;
+using namespace llvm;
+
+STATISTIC(NumProfiledCheckSites,
+          "The # of check sites with an execution counter");
+
+namespace {
+
+cl::opt<bool> ProfileChecks(
+    "mi-profile-checks",
+    cl::desc("Count the executions of each check site, the run-time writes "
+             "the counts to a profile database at exit"),
+    cl::init(false));
+
+/// The slice of the counter array that belongs to a function, with the
+/// locations of the check sites that are counted.
+struct CounterSlice {
+  Function *fun = nullptr;
+  uint64_t offset = 0;
+  SmallVector<Instruction *, 16> sites;
+};
+
+} // namespace
+
+bool meminstrument::isCheckProfilingEnabled() { return ProfileChecks; }
+
+void meminstrument::insertCheckProfiler(
+    Module &M, std::map<Function *, ITargetVector> &targetMap) {
+  auto &Ctx = M.getContext();
+  auto *I64Ty = Type::getInt64Ty(Ctx);
+  auto *StringTy = Type::getInt8PtrTy(Ctx);
+
+  // Each function gets a slice of the counters with one counter per check
+  // site. Multiple checks at the same location share one counter.
+  SmallVector<CounterSlice, 16> slices;
+  uint64_t numCounters = 0;
+  for (auto &F : M) {
+    auto it = targetMap.find(&F);
+    if (it == targetMap.end()) {
+      continue;
+    }
+    CounterSlice slice;
+    slice.fun = &F;
+    slice.offset = numCounters;
+    SmallPtrSet<Instruction *, 32> seen;
+    for (auto &target : it->second) {
+      if (!target->isValid() || !target->isCheck()) {
+        continue;
+      }
+      auto *location = target->getLocation();
+      if (hasAccessID(location) && seen.insert(location).second) {
+        slice.sites.push_back(location);
+      }
+    }
+    if (!slice.sites.empty()) {
+      numCounters += slice.sites.size();
+      slices.push_back(std::move(slice));
+    }
+  }
+  if (slices.empty()) {
+    return;
+  }
+
+  auto *CountersTy = ArrayType::get(I64Ty, numCounters);
+  auto *Counters = new GlobalVariable(
+      M, CountersTy, false, GlobalValue::InternalLinkage,
+      Constant::getNullValue(CountersTy), "__mi_check_counts");
+  setNoInstrument(Counters);
+
+  // The access IDs of the counted sites, in the order of the counters
+  std::vector<Constant *> IDs;
+
+  // Count the executions right in front of the access
+  for (const auto &slice : slices) {
+    for (auto *location : slice.sites) {
+      IRBuilder<> Builder(location);
+      auto *Counter = Builder.CreateConstInBoundsGEP2_64(CountersTy, Counters,
+                                                         0, IDs.size());
+      IDs.push_back(ConstantInt::get(I64Ty, getAccessID(location)));
+      auto *Count = Builder.CreateLoad(I64Ty, Counter, "mi_check_count");
+      auto *Inc = Builder.CreateAdd(Count, ConstantInt::get(I64Ty, 1));
+      auto *Store = Builder.CreateStore(Inc, Counter);
+      setNoInstrument(Count);
+      setNoInstrument(Store);
+      ++NumProfiledCheckSites;
+    }
+  }
+
+  auto *IDsGV = new GlobalVariable(M, CountersTy, true,
+                                   GlobalValue::InternalLinkage,
+                                   ConstantArray::get(CountersTy, IDs),
+                                   "__mi_check_ids");
+  setNoInstrument(IDsGV);
+
+  // Describe the slices for the run-time
+  auto *EntryTy = StructType::get(StringTy, I64Ty, I64Ty);
+  std::vector<Constant *> Entries;
+  for (const auto &slice : slices) {
+    auto *Name = InstrumentationMechanism::insertStringLiteral(
+        M, slice.fun->getName());
+    Entries.push_back(ConstantStruct::get(
+        EntryTy, ConstantExpr::getPointerCast(Name, StringTy),
+        ConstantInt::get(I64Ty, slice.offset),
+        ConstantInt::get(I64Ty, slice.sites.size())));
+  }
+  auto *TableTy = ArrayType::get(EntryTy, Entries.size());
+  auto *Table = new GlobalVariable(M, TableTy, true,
+                                   GlobalValue::InternalLinkage,
+                                   ConstantArray::get(TableTy, Entries),
+                                   "__mi_check_profile_functions");
+  setNoInstrument(Table);
+
+  auto RegisterFun =
+      M.getOrInsertFunction("__mi_check_profile_register",
+                            Type::getVoidTy(Ctx), StringTy,
+                            PointerType::getUnqual(I64Ty),
+                            PointerType::getUnqual(I64Ty), StringTy, I64Ty);
+  setNoInstrument(RegisterFun.getCallee());
+
+  auto *Setup =
+      InstrumentationMechanism::insertSetupCtor(M, "__mi_check_profile_setup");
+  IRBuilder<> Builder(Setup->getTerminator());
+  auto *ModuleName = InstrumentationMechanism::insertStringLiteral(
+      M, M.getName());
+  Builder.CreateCall(
+      RegisterFun,
+      {Builder.CreatePointerCast(ModuleName, StringTy),
+       Builder.CreateConstInBoundsGEP2_64(CountersTy, Counters, 0, 0),
+       Builder.CreateConstInBoundsGEP2_64(CountersTy, IDsGV, 0, 0),
+       Builder.CreatePointerCast(Table, StringTy),
+       ConstantInt::get(I64Ty, slices.size())});
+}
@@ -0,0 +1,140 @@
+//===- DualVersion.cpp - Checked/Unchecked Function Copies ----------------===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "meminstrument/pass/DualVersion.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "meminstrument/pass/Util.h"
+
+using namespace meminstrument;
+using namespace llvm;
+
+STATISTIC(NumDualVersionFunctions,
+          "The # of functions with an unchecked copy");
+
+namespace {
+
+cl::opt<bool> DualVersion(
+    "mi-dual-version",
+    cl::desc("Keep an unchecked copy of each instrumented function and "
+             "dispatch to it at function entry if checks are disabled at run "
+             "time"),
+    cl::init(false));
+
+GlobalVariable *getChecksEnabledFlag(Module &M) {
+  if (auto *flag = M.getNamedGlobal("__mi_checks_enabled")) {
+    return flag;
+  }
+  auto *I8Ty = Type::getInt8Ty(M.getContext());
+  auto *flag = new GlobalVariable(M, I8Ty, false, GlobalValue::WeakAnyLinkage,
+                                  ConstantInt::get(I8Ty, 1),
+                                  "__mi_checks_enabled");
+  setNoInstrument(flag);
+  return flag;
+}
+
+/// Create a module constructor that clears the flag if the environment
+/// variable MI_DISABLE_CHECKS is set.
+void insertChecksEnabledSetup(Module &M, GlobalVariable *flag) {
+  Value *Env = nullptr;
+  auto *Disable = InstrumentationMechanism::insertSetupCtor(
+      M, "__mi_dual_version_setup", "MI_DISABLE_CHECKS", Env);
+
+  IRBuilder<> Builder(Disable->getTerminator());
+  setNoInstrument(Builder.CreateStore(Builder.getInt8(0), flag));
+}
+
+/// Split the entry block of \p F behind its leading allocas and branch to a
+/// call of \p unchecked if the flag is not set.
+void insertDispatch(Function &F, Function &unchecked, GlobalVariable *flag) {
+  auto &Ctx = F.getContext();
+  auto &entry = F.getEntryBlock();
+
+  // Keep the static allocas in the entry block, they are free to execute
+  auto splitPt = entry.begin();
+  while (isa<AllocaInst>(*splitPt)) {
+    ++splitPt;
+  }
+  auto *checkedBlock = SplitBlock(&entry, &*splitPt, (DominatorTree *)nullptr,
+                                  nullptr, nullptr, "mi_checked");
+
+  auto *uncheckedBlock = BasicBlock::Create(Ctx, "mi_unchecked", &F);
+  IRBuilder<> Builder(uncheckedBlock);
+  SmallVector<Value *, 8> args;
+  for (auto &arg : F.args()) {
+    args.push_back(&arg);
+  }
+  auto *call = Builder.CreateCall(&unchecked, args);
+  call->setTailCall();
+  call->setCallingConv(F.getCallingConv());
+  call->setAttributes(F.getAttributes());
+  setNoInstrument(call);
+  if (F.getReturnType()->isVoidTy()) {
+    Builder.CreateRetVoid();
+  } else {
+    Builder.CreateRet(call);
+  }
+
+  auto *term = entry.getTerminator();
+  Builder.SetInsertPoint(term);
+  auto *load = Builder.CreateLoad(Type::getInt8Ty(Ctx), flag,
+                                  "mi_checks_enabled");
+  load->setAtomic(AtomicOrdering::Monotonic);
+  load->setAlignment(Align(1));
+  setNoInstrument(load);
+  Builder.CreateCondBr(Builder.CreateIsNotNull(load), checkedBlock,
+                       uncheckedBlock);
+  term->eraseFromParent();
+}
+
+} // namespace
+
+bool meminstrument::isDualVersionEnabled() { return DualVersion; }
+
+void meminstrument::createDualVersions(Module &M,
+                                       const InstrumentationMechanism &IM) {
+  if (!IM.invariantsAreChecks()) {
+    // The unchecked copy would not maintain the metadata that the checked
+    // functions rely on
+    MemInstrumentError::report(
+        "Dual version functions are only supported for instrumentation "
+        "mechanisms without metadata propagation.");
+  }
+
+  SmallVector<Function *, 32> functions;
+  for (auto &F : M) {
+    if (F.isDeclaration() || hasNoInstrument(&F) || F.isVarArg()) {
+      // A variadic function cannot forward its arguments to the copy
+      continue;
+    }
+    functions.push_back(&F);
+  }
+  if (functions.empty()) {
+    return;
+  }
+
+  auto *flag = getChecksEnabledFlag(M);
+  insertChecksEnabledSetup(M, flag);
+
+  for (auto *F : functions) {
+    ValueToValueMapTy VMap;
+    auto *unchecked = CloneFunction(F, VMap);
+    unchecked->setName(F->getName() + ".mi_unchecked");
+    unchecked->setLinkage(GlobalValue::InternalLinkage);
+    unchecked->setVisibility(GlobalValue::DefaultVisibility);
+    unchecked->setComdat(F->getComdat());
+    setNoInstrument(unchecked);
+
+    insertDispatch(*F, *unchecked, flag);
+    ++NumDualVersionFunctions;
+  }
+}
@@ -11,6 +11,8 @@
 #include "meminstrument/instrumentation_mechanisms/InstrumentationMechanism.h"
 #include "meminstrument/optimizations/OptimizationRunner.h"
 #include "meminstrument/pass/CheckGeneration.h"
+#include "meminstrument/pass/CheckProfiler.h"
+#include "meminstrument/pass/DualVersion.h"
 #include "meminstrument/pass/ITarget.h"
 #include "meminstrument/pass/ITargetGathering.h"
 #include "meminstrument/pass/Setup.h"
@@ -65,6 +67,11 @@ void dropFunctionAttributes(
       // without certain attributes
       continue;
     }
+    if (fun.isDeclaration() && hasNoInstrument(&fun)) {
+      // run-time functions declared by the instrumentation mechanism carry
+      // attributes that are valid for the instrumented program
+      continue;
+    }
     if (skipFunctions.count(&fun) == 0) {
       auto attrs = fun.getAttributes();
       auto newAttrs = dropAttributes(context, attrsToDrop, attrs,
@@ -194,6 +201,35 @@ void dropInvalidatedFunctionAttributes(
   dropFunctionAttributes(context, dropNoMem, M, noDropNoMem);
 }
 
+/// Generate witnesses, invariants and checks for the targets of F, as far as
+/// the configured mode requires.
+void generateForFunction(GlobalConfig &CFG, OptimizationRunner &optRunner,
+                         ITargetVector &Targets, Function &F) {
+  MIMode Mode = CFG.getMIMode();
+
+  LLVM_DEBUG(dbgs() << "MemInstrumentPass: generating Witnesses\n";);
+
+  generateWitnesses(CFG, Targets, F);
+
+  if (Mode == MIMode::GENERATE_WITNESSES)
+    return;
+
+  generateInvariants(CFG, Targets, F);
+
+  if (Mode == MIMode::GENERATE_INVARIANTS) {
+    return;
+  }
+
+  optRunner.placeChecks(Targets, F);
+
+  if (Mode == MIMode::GENERATE_OPTIMIZATION_CHECKS)
+    return;
+
+  LLVM_DEBUG(dbgs() << "MemInstrumentPass: generating checks\n";);
+
+  generateChecks(CFG, Targets, F);
+}
+
 bool MemInstrumentPass::runOnModule(Module &M) {
 
   CFG = GlobalConfig::create(M);
@@ -232,6 +268,12 @@ bool MemInstrumentPass::runOnModule(Module &M) {
   if (Mode == MIMode::SETUP)
     return true;
 
+  if (isDualVersionEnabled()) {
+    LLVM_DEBUG(dbgs() << "MemInstrumentPass: creating unchecked copies\n";);
+
+    createDualVersions(M, IM);
+  }
+
   std::map<Function *, ITargetVector> TargetMap;
 
   for (auto &F : M) {
@@ -261,29 +303,17 @@ bool MemInstrumentPass::runOnModule(Module &M) {
       continue;
     }
 
-    auto &Targets = TargetMap[&F];
-
-    LLVM_DEBUG(dbgs() << "MemInstrumentPass: generating Witnesses\n";);
-
-    generateWitnesses(*CFG, Targets, F);
-
-    if (Mode == MIMode::GENERATE_WITNESSES)
-      continue;
-
-    generateInvariants(*CFG, Targets, F);
-
-    if (Mode == MIMode::GENERATE_INVARIANTS) {
-      continue;
-    }
-
-    optRunner.placeChecks(Targets, F);
+    generateForFunction(*CFG, optRunner, TargetMap[&F], F);
 
-    if (Mode == MIMode::GENERATE_OPTIMIZATION_CHECKS)
-      continue;
+    // Checks may be deferred in every mode that generates them (e.g.,
+    // invariants that are checks), flush them before the next function.
+    IM.materializeDeferredChecks(F);
+  }
 
-    LLVM_DEBUG(dbgs() << "MemInstrumentPass: generating checks\n";);
+  if (isCheckProfilingEnabled()) {
+    LLVM_DEBUG(dbgs() << "MemInstrumentPass: profiling check sites\n";);
 
-    generateChecks(*CFG, Targets, F);
+    insertCheckProfiler(M, TargetMap);
   }
 
   DEBUG_ALSO_WITH_TYPE("meminstrument-finalmodule", M.dump(););
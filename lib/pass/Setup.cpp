@@ -7,17 +7,23 @@
 
 #include "meminstrument/pass/Setup.h"
 
+#include "meminstrument/pass/CheckGeneration.h"
+#include "meminstrument/pass/CheckProfiler.h"
 #include "meminstrument/pass/Util.h"
 
 #include "llvm/ADT/Statistic.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/LineIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/xxhash.h"
 
+#include <map>
 #include <string>
+#include <tuple>
 
 using namespace llvm;
 using namespace meminstrument;
@@ -62,7 +68,8 @@ cl::opt<bool> KeepLifeTimeIntrinsics(
 
 cl::opt<bool> LabelAccesses(
     "mi-label-accesses",
-    cl::desc("Add unique ids as metadata to load an store instructions"),
+    cl::desc("Add ids that are stable across builds as metadata to load and "
+             "store instructions"),
     cl::init(false));
 
 cl::opt<bool> NoTransformObfuscatedPointer(
@@ -310,15 +317,31 @@ void transformByValFunctions(Module &module) {
   }
 }
 
-void labelAccesses(Function &F) {
-  // This heavily relies on clang and llvm behaving deterministically
-  // (which may or may not be the case)
-  uint64_t idx = 0;
+void meminstrument::labelAccesses(Function &F) {
+  // The IDs are derived from the function name, the debug location and the
+  // opcode of the access, such that they remain stable if unrelated code
+  // changes. Accesses that share these properties are distinguished by their
+  // order. They are limited to 63 bits to be stored as signed integers in
+  // profile databases.
+  std::map<std::tuple<unsigned, unsigned, unsigned>, uint64_t> ordinals;
   for (auto &BB : F) {
     for (auto &I : BB) {
-      if (isa<StoreInst>(&I) || isa<LoadInst>(&I)) {
-        setAccessID(&I, idx++);
+      if (!isa<StoreInst>(&I) && !isa<LoadInst>(&I)) {
+        continue;
+      }
+      unsigned line = 0;
+      unsigned column = 0;
+      if (const DILocation *loc = I.getDebugLoc()) {
+        line = loc->getLine();
+        column = loc->getColumn();
       }
+      auto ordinal = ordinals[{line, column, I.getOpcode()}]++;
+
+      std::string key;
+      raw_string_ostream keyStream(key);
+      keyStream << F.getName() << ":" << line << ":" << column << ":"
+                << I.getOpcodeName() << ":" << ordinal;
+      setAccessID(&I, xxHash64(keyStream.str()) & INT64_MAX);
     }
   }
 }
@@ -753,7 +776,8 @@ void meminstrument::prepareModule(Module &module) {
       removeLifeTimeIntrinsics(fun);
     }
 
-    if (LabelAccesses) {
+    if (LabelAccesses || isCheckProfilingEnabled() ||
+        isPatchableChecksEnabled()) {
       labelAccesses(fun);
     }
 
@@ -12,6 +12,7 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalObject.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -165,6 +166,29 @@ size_t getPointerAccessSize(const DataLayout &DL, Value *V) {
   return Size;
 }
 
+bool getStaticAllocationSize(const DataLayout &DL, const Value *V,
+                             uint64_t &size) {
+  if (const auto *AI = dyn_cast<AllocaInst>(V)) {
+    auto AllocSize = AI->getAllocationSizeInBits(DL);
+    if (!AllocSize || AllocSize->isScalable()) {
+      return false;
+    }
+    size = AllocSize->getFixedSize() / 8;
+    return true;
+  }
+
+  if (const auto *GV = dyn_cast<GlobalVariable>(V)) {
+    // Other definitions of interposable globals might be larger or smaller
+    if (!GV->hasDefinitiveInitializer() || !GV->getValueType()->isSized()) {
+      return false;
+    }
+    size = DL.getTypeAllocSize(GV->getValueType()).getFixedSize();
+    return true;
+  }
+
+  return false;
+}
+
 bool canHoldMetadata(const Value *V) {
   return isa<Instruction>(V) || isa<GlobalObject>(V);
 }
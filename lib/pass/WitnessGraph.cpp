@@ -35,6 +35,29 @@ void WitnessGraphNode::clearRequirements(void) {
 
 WitnessGraphNode::~WitnessGraphNode(void) { clearRequirements(); }
 
+WitnessGraph::~WitnessGraph(void) {
+  // Unlink all nodes first so that no destructor touches an already destroyed
+  // node. The memory itself is released with the allocator.
+  map([](WitnessGraphNode *N) { N->clearRequirements(); });
+  map([](WitnessGraphNode *N) { N->~WitnessGraphNode(); });
+}
+
+WitnessGraph::NodeKey WitnessGraph::getNodeKey(const ITarget &T) {
+  return std::make_pair(std::make_pair(T.getInstrumentee(), T.getLocation()),
+                        static_cast<unsigned>(T.getKind()));
+}
+
+WitnessGraphNode *WitnessGraph::allocateNode(ITargetPtr Target) {
+  auto *Mem = NodeAllocator.Allocate<WitnessGraphNode>();
+  return new (Mem) WitnessGraphNode(*this, Target);
+}
+
+void WitnessGraph::destroyNode(WitnessGraphNode *N) {
+  // The memory is not reused, it stays with the allocator until the graph is
+  // destroyed.
+  N->~WitnessGraphNode();
+}
+
 WitnessGraphNode *WitnessGraph::getInternalNode(ITargetPtr Target) {
   // see whether we already have a node for Target
   if (auto *Node = getInternalNodeOrNull(Target)) {
@@ -48,15 +71,20 @@ WitnessGraphNode *WitnessGraph::createNewInternalNode(ITargetPtr Target) {
   assert(getInternalNodeOrNull(Target) == nullptr &&
          "Internal node already exists!");
 
-  auto *NewNode = new WitnessGraphNode(*this, Target);
+  auto *NewNode = allocateNode(Target);
   InternalNodes.push_back(NewNode);
+  InternalNodeIndex[getNodeKey(*Target)].push_back(NewNode);
 
   return NewNode;
 }
 
 WitnessGraphNode *WitnessGraph::getInternalNodeOrNull(ITargetPtr Target) {
+  auto It = InternalNodeIndex.find(getNodeKey(*Target));
+  if (It == InternalNodeIndex.end()) {
+    return nullptr;
+  }
 
-  for (auto *WGN : InternalNodes) {
+  for (auto *WGN : It->second) {
     if (*WGN->Target == *Target) {
       return WGN;
     }
@@ -66,7 +94,7 @@ WitnessGraphNode *WitnessGraph::getInternalNodeOrNull(ITargetPtr Target) {
 }
 
 void WitnessGraph::insertRequiredTarget(ITargetPtr T) {
-  auto *Res = new WitnessGraphNode(*this, T);
+  auto *Res = allocateNode(T);
   ExternalNodes.push_back(Res);
   Strategy.addRequired(Res);
   AlreadyPropagated = false;
@@ -245,21 +273,43 @@ void WitnessGraph::removeDeadNodes(void) {
                       ExternalNodes.end());
 
   for (auto *N : ToDelete) {
-    delete N;
+    destroyNode(N);
   }
 
   for (auto &N : ExternalNodes) {
     markAsReachable(DoNotRemove, N);
   }
 
-  for (auto it = InternalNodes.begin(); it != InternalNodes.end();) {
-    if (DoNotRemove.find(*it) != DoNotRemove.end()) {
-      ++it;
-    } else {
-      delete *it;
-      it = InternalNodes.erase(it);
+  ToDelete.clear();
+  InternalNodes.erase(std::remove_if(InternalNodes.begin(), InternalNodes.end(),
+                                     [&](WitnessGraphNode *N) {
+                                       bool res = DoNotRemove.find(N) ==
+                                                  DoNotRemove.end();
+                                       if (res) {
+                                         ToDelete.push_back(N);
+                                       }
+                                       return res;
+                                     }),
+                      InternalNodes.end());
+
+  for (auto *N : ToDelete) {
+    auto It = InternalNodeIndex.find(getNodeKey(*N->Target));
+    assert(It != InternalNodeIndex.end() && "Internal node is not indexed!");
+    auto &Bucket = It->second;
+    Bucket.erase(std::remove(Bucket.begin(), Bucket.end(), N), Bucket.end());
+    if (Bucket.empty()) {
+      InternalNodeIndex.erase(It);
     }
   }
+
+  // Dead nodes may require each other, unlink all of them before destroying
+  // any.
+  for (auto *N : ToDelete) {
+    N->clearRequirements();
+  }
+  for (auto *N : ToDelete) {
+    destroyNode(N);
+  }
 }
 
 void WitnessGraph::map(const std::function<void(WitnessGraphNode *)> &f) {
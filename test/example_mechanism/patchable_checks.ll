@@ -0,0 +1,23 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=example -mi-patchable-checks -S | %filecheck %s
+
+; CHECK: @__mi_site_module = internal constant [{{[0-9]+}} x i8] c"{{.*}}patchable_checks.ll\00"
+; CHECK: @__mi_site = internal global { i64, i8*, i8 } { i64 {{[0-9]+}}, i8* bitcast ([{{[0-9]+}} x i8]* @__mi_site_module to i8*), i8 1 }, section "mi_sites", align 8
+; CHECK: @__mi_site.1 = internal global { i64, i8*, i8 } { i64 {{[0-9]+}}, i8* bitcast ([{{[0-9]+}} x i8]* @__mi_site_module to i8*), i8 1 }, section "mi_sites", align 8
+; CHECK: @llvm.compiler.used = {{.*}} @__mi_site {{.*}} @__mi_site.1
+
+define void @test(i32* %p, i32* %q) {
+bb:
+  %x = load i32, i32* %p
+  store i32 %x, i32* %q
+  ret void
+}
+
+; CHECK-LABEL: define void @test
+; CHECK: %mi_site_enabled = load atomic i8, i8* getelementptr inbounds ({ i64, i8*, i8 }, { i64, i8*, i8 }* @__mi_site, i32 0, i32 2) monotonic
+; CHECK: br i1 {{.*}}, label %mi_guarded, label %mi_guarded_cont
+; CHECK: mi_guarded:
+; CHECK: store volatile {{.*}} @mi_check_result_location
+; CHECK: mi_guarded_cont:
+; CHECK-NEXT: %x = load i32, i32* %p
+; CHECK: %mi_site_enabled{{[0-9]+}} = load atomic i8, {{.*}} @__mi_site.1
+; CHECK: store i32 %x, i32* %q
@@ -0,0 +1,41 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=example -mi-sample-checks=64 -S | %filecheck %s
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=example -mi-sample-checks=64 -mi-patchable-checks -S | %filecheck %s --check-prefix=SITE
+
+; CHECK: @__mi_sample_countdown = internal thread_local global i64 1
+; CHECK: @__mi_sample_period = internal global i64 64
+; CHECK: @llvm.global_ctors = {{.*}} @__mi_sample_setup
+
+define i32 @test(i32* %p) {
+bb:
+  %x = load i32, i32* %p
+  ret i32 %x
+}
+
+; CHECK-LABEL: define i32 @test
+; CHECK: %mi_sample_countdown = load i64, i64* @__mi_sample_countdown
+; CHECK-NEXT: [[NEXT:%.*]] = sub i64 %mi_sample_countdown, 1
+; CHECK-NEXT: store i64 [[NEXT]], i64* @__mi_sample_countdown
+; CHECK-NEXT: %mi_sample = icmp eq i64 [[NEXT]], 0
+; CHECK-NEXT: br i1 %mi_sample, label %mi_guarded, label %mi_guarded_cont
+; CHECK: mi_guarded:
+; CHECK-NEXT: %mi_sample_period = load i64, i64* @__mi_sample_period
+; CHECK-NEXT: store i64 %mi_sample_period, i64* @__mi_sample_countdown
+; CHECK: store volatile {{.*}} @mi_check_result_location
+; CHECK: mi_guarded_cont:
+; CHECK-NEXT: %x = load i32, i32* %p
+
+; The countdown is reset on every sampled execution, even if the site is
+; disabled.
+; SITE-LABEL: define i32 @test
+; SITE: br i1 %mi_sample, label %mi_sampled, label %mi_guarded_cont
+; SITE: mi_sampled:
+; SITE-NEXT: %mi_sample_period = load i64, i64* @__mi_sample_period
+; SITE-NEXT: store i64 %mi_sample_period, i64* @__mi_sample_countdown
+; SITE: br i1 {{.*}}, label %mi_guarded, label %mi_guarded_cont
+; SITE: mi_guarded:
+; SITE: store volatile {{.*}} @mi_check_result_location
+
+; CHECK-LABEL: define internal void @__mi_sample_setup
+; CHECK: call i8* @getenv
+; CHECK: call i64 @strtoull
+; CHECK: store i64 {{.*}}, i64* @__mi_sample_period
@@ -0,0 +1,16 @@
+// RUN: %clang -fplugin=%passlib -mcmodel=large -O1 %s -mllvm -mi-config=lowfat -mllvm -mi-static-witnesses -emit-llvm -S -o %t.ll
+// RUN: %clang -mcmodel=large %t.ll %linklowfat -o %t
+// RUN: %not --crash %t 1 1 1 1 1 1 1 1 1 1 1 1 1 1 2> /dev/null
+
+// The global has size 15, which lowfat pads to 16. With static witnesses, the
+// exact size of the global is used, hence accessing index 15 is detected.
+
+#include <stdio.h>
+
+char Ar[15];
+
+int main(int argc, char const *argv[]) {
+    printf("Num args: %d\n", argc);
+    printf("Entry there: %c\n", Ar[argc]);
+    return 0;
+}
@@ -0,0 +1,14 @@
+// RUN: %clang -mcmodel=large -fplugin=%passlib -O1 %s -mllvm -mi-config=lowfat -mllvm -mi-lf-inline-checks %linklowfat -o %t
+// RUN: %t
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char const *argv[]) {
+    char *Ar = malloc(15);
+    for (int i = 0; i < 15; i++) {
+        Ar[i] = i + 65;
+    }
+    printf("Entry there: %c\n", Ar[argc - 1]);
+    return 0;
+}
@@ -0,0 +1,17 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-available -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 1 {{.*}} discarded because of available checks on all paths
+
+// REQUIRES: asserts
+
+int example_join(int *p, int c) {
+    int r;
+    if (c) {
+        r = *p + 1;
+    } else {
+        r = *p - 1;
+    }
+    // Both branches checked p, no single check dominates this one, though
+    return r + *p;
+}
@@ -0,0 +1,19 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-coalesce -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 1 {{.*}} placed for coalesced checks
+// CHECK: 3 {{.*}} discarded because of coalescing them with others
+
+// REQUIRES: asserts
+
+struct msg {
+    int a;
+    int b;
+    long c;
+};
+
+long sum_fields(struct msg *m) {
+    // The field accesses are executed one after the other, a single check for
+    // the range from m->a to the end of m->c suffices
+    return m->a + m->b + m->c;
+}
@@ -0,0 +1,18 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-dominance -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 1 {{.*}} discarded because of dominating subsumption
+
+// REQUIRES: asserts
+
+struct pair {
+    long a;
+    long b;
+};
+
+long copy_and_get(struct pair *p, struct pair *q) {
+    // The copy checks the whole struct p points to, which covers the later
+    // access to p->b at offset 8
+    *q = *p;
+    return p->b;
+}
@@ -0,0 +1,29 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-early-args -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 1 {{.*}} placed at function entries
+// CHECK: 3 {{.*}} discarded because of checking them at the function entry
+
+// REQUIRES: asserts
+
+#include <stdlib.h>
+
+struct point {
+    int x;
+    int y;
+    int z;
+};
+
+int norm1(struct point *p) {
+    // All fields are accessed in every execution, one check of the whole
+    // struct at the entry suffices
+    return abs(p->x) + abs(p->y) + abs(p->z);
+}
+
+int conditional(struct point *p, int c) {
+    // The access is not executed in every execution, it stays where it is
+    if (c) {
+        return p->x;
+    }
+    return 0;
+}
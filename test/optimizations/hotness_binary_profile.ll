@@ -0,0 +1,30 @@
+; RUN: printf 'MIPROF01\001\0\0\0\0\0\0\0\007\0\0\0\0\0\0\0\001\0\0\0\0\0\0\0<stdin>\0\004\0\0\0\0\0\0\0\002\0\0\0\0\0\0\0test\0\0\0\0\0\0\0\0\0\0\0\0\350\003\0\0\0\0\0\0\001\0\0\0\0\0\0\0\001\0\0\0\0\0\0\0' > %t.prof
+; RUN: cat %s | %opt %loadlibs -meminstrument -mi-config=example -mi-opt-hotness -mi-opt-hotness-filter-ordering=budget -mi-opt-hotness-budget=0.1 -mi-profile-db-path=%t.prof -stats -S 2>&1 | %filecheck %s
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=example -mi-opt-hotness -mi-opt-hotness-filter-ordering=budget -mi-opt-hotness-budget=0.1 -mi-profile-db-path=%t.prof -stats -S 2>&1 | %filecheck %s --check-prefix=MISSING
+
+; The load is executed 1000 times and the store once, only the check of the
+; store fits into the budget of 10% of the profiled accesses.
+
+; CHECK: 1 {{.*}} checks kept within the overhead budget
+; CHECK: 1 {{.*}} checks filtered by hotness
+; CHECK: 2 {{.*}} loaded profile entries
+
+; Read from a file, the module has a different name than in the profile. The
+; failed module lookup counts like the failed lookups of the two accesses.
+
+; MISSING: 3 {{.*}} failing hotness lookups
+; MISSING: 2 {{.*}} checks kept within the overhead budget
+
+; REQUIRES: asserts
+
+define i32 @test(i32* %p) {
+bb:
+  %p1 = getelementptr i32, i32* %p, i64 0
+  %x1 = load i32, i32* %p1, !mi_access_id !0
+  %p2 = getelementptr i32, i32* %p, i64 1
+  store i32 %x1, i32* %p2, !mi_access_id !1
+  ret i32 %x1
+}
+
+!0 = !{!"0"}
+!1 = !{!"1"}
@@ -0,0 +1,30 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=example -mi-opt-hotness -mi-opt-hotness-source=block-frequency -mi-opt-hotness-filter-ordering=budget -mi-opt-hotness-budget=0.1 -stats -S 2>&1 | %filecheck %s
+
+; Without a profile, the load in the loop is estimated to execute much more
+; often than the store at the entry, only the check of the store fits into the
+; budget.
+
+; CHECK: 1 {{.*}} checks kept within the overhead budget
+; CHECK: 1 {{.*}} checks filtered by hotness
+
+; REQUIRES: asserts
+
+define i32 @test(i32* %p, i32 %n) {
+entry:
+  store i32 0, i32* %p
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %idx = sext i32 %i to i64
+  %p.i = getelementptr i32, i32* %p, i64 %idx
+  %x = load i32, i32* %p.i
+  %sum.next = add i32 %sum, %x
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret i32 %sum.next
+}
@@ -0,0 +1,37 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=example -mi-opt-hotness -mi-opt-hotness-filter-ordering=budget -mi-opt-hotness-budget=0.1 -stats -S 2>&1 | %filecheck %s --check-prefix=NOPROF
+; RUN: printf 'MIPROF01\001\000\000\000\000\000\000\000\007\000\000\000\000\000\000\000\001\000\000\000\000\000\000\000<stdin>\000\004\000\000\000\000\000\000\000\003\000\000\000\000\000\000\000test\000\000\000\000\000\000\000\000\000\000\000\000\350\003\000\000\000\000\000\000\001\000\000\000\000\000\000\000\012\000\000\000\000\000\000\000\002\000\000\000\000\000\000\000\050\000\000\000\000\000\000\000' > %t.prof
+; RUN: cat %s | %opt %loadlibs -meminstrument -mi-config=example -mi-opt-hotness -mi-opt-hotness-filter-ordering=budget -mi-opt-hotness-budget=0.1 -mi-profile-db-path=%t.prof -stats -S 2>&1 | %filecheck %s --check-prefix=BUDGET10
+; RUN: cat %s | %opt %loadlibs -meminstrument -mi-config=example -mi-opt-hotness -mi-opt-hotness-filter-ordering=budget -mi-opt-hotness-budget=0.04 -mi-profile-db-path=%t.prof -stats -S 2>&1 | %filecheck %s --check-prefix=BUDGET4
+
+; Without profile data, no check is expected to execute, so all checks fit into
+; the budget.
+
+; NOPROF: 3 {{.*}} checks kept within the overhead budget
+; NOPROF-NOT: checks filtered by hotness
+
+; The accesses are executed 1000, 10, and 40 times, each check costs as much as
+; one access. A budget of 10% (105 executions) fits the checks of the two cold
+; accesses, 4% (42 executions) only fits the coldest one.
+
+; BUDGET10: 2 {{.*}} checks kept within the overhead budget
+; BUDGET10: 1 {{.*}} checks filtered by hotness
+
+; BUDGET4: 1 {{.*}} checks kept within the overhead budget
+; BUDGET4: 2 {{.*}} checks filtered by hotness
+
+; REQUIRES: asserts
+
+define i32 @test(i32* %p) {
+bb:
+  %p1 = getelementptr i32, i32* %p, i64 0
+  %x1 = load i32, i32* %p1, !mi_access_id !0
+  %p2 = getelementptr i32, i32* %p, i64 1
+  store i32 %x1, i32* %p2, !mi_access_id !1
+  %p3 = getelementptr i32, i32* %p, i64 2
+  %x3 = load i32, i32* %p3, !mi_access_id !2
+  ret i32 %x3
+}
+
+!0 = !{!"0"}
+!1 = !{!"1"}
+!2 = !{!"2"}
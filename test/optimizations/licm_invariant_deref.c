@@ -0,0 +1,28 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-licm -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 1 {{.*}} discarded because of hoisting them out of a loop
+// CHECK: 1 {{.*}} placed in loop preheaders
+
+// REQUIRES: asserts
+
+int sum_invariant(int *q, int n) {
+    int s = 0;
+    int i = 0;
+    do {
+        // The dereference of q is executed in every iteration, it can be
+        // checked once before entering the loop
+        s += *q;
+        i++;
+    } while (i < n);
+    return s;
+}
+
+int sum_invariant_conditional(int *q, int n) {
+    int s = 0;
+    for (int i = 0; i < n; i++) {
+        // The loop body might not be executed, the check has to stay here
+        s += *q;
+    }
+    return s;
+}
@@ -0,0 +1,15 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-loop-range -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 1 {{.*}} discarded because of loop range checks
+// CHECK: 1 {{.*}} loop range checks inserted
+
+// REQUIRES: asserts
+
+void fill(int *a, int n) {
+    for (int i = 0; i < n; i++) {
+        // The stores access the range [a, a + n), which can be checked once
+        // before the loop if n is not zero
+        a[i] = i;
+    }
+}
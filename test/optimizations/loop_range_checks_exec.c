@@ -0,0 +1,21 @@
+// RUN: %clang -fplugin=%passlib -O1 %s -mllvm -mi-config=splay -mllvm -mi-opt-loop-range %linksplay -o %t
+// RUN: %t
+// RUN: %not --crash %t 1 2> /dev/null
+
+#include <stdlib.h>
+
+__attribute__((noinline)) void fill(int *a, int n) {
+    for (int i = 0; i < n; i++) {
+        a[i] = i;
+    }
+}
+
+int main(int argc, char const *argv[]) {
+    int *a = malloc(10 * sizeof(int));
+    // Loops that do not access memory must not fail
+    fill(NULL, 0);
+    // One element past the end of the array with an additional argument
+    fill(a, 9 + argc);
+    free(a);
+    return 0;
+}
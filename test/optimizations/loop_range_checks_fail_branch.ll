@@ -0,0 +1,33 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-opt-loop-range -S | %filecheck %s
+
+; The range check in the preheader uses the shared fail block of the
+; instrumentation mechanism.
+
+; CHECK-LABEL: define void @fill
+; CHECK: ph:
+; CHECK: br i1 {{.*}}, label %mi_fail, label %ph.mi_cont
+; CHECK: loop:
+; CHECK-NOT: call void @__splay_check_dereference
+; CHECK: mi_fail:
+; CHECK-NEXT: call void @__mi_fail()
+; CHECK-NEXT: unreachable
+
+define void @fill(i32* %a, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %ph, label %exit
+
+ph:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %ph ], [ %i.next, %loop ]
+  %p = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %p
+  %i.next = add nuw nsw i64 %i, 1
+  %c = icmp slt i64 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,21 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-loop-versioning -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 1 {{.*}} loops versioned with an unchecked fast path
+// CHECK: 1 {{.*}} skipped on the fast path of versioned loops
+
+// REQUIRES: asserts
+
+void report(int i);
+
+int fill(int *a, int n) {
+    int sum = 0;
+    for (int i = 0; i < n; i++) {
+        // The call might not return, so the range [a, a + n) cannot replace
+        // the check of the store. It still selects the unchecked loop version.
+        a[i] = i;
+        report(i);
+        sum += i;
+    }
+    return sum;
+}
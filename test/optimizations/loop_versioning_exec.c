@@ -0,0 +1,32 @@
+// RUN: %clang -fplugin=%passlib -O1 %s -mllvm -mi-config=splay -mllvm -mi-opt-loop-versioning %linksplay -o %t
+// RUN: %t
+// RUN: %not --crash %t 1 2> /dev/null
+
+#include <stdlib.h>
+
+__attribute__((noinline)) void report(int i) {
+    if (i < 0) {
+        exit(1);
+    }
+}
+
+__attribute__((noinline)) int fill(int *a, int n) {
+    int sum = 0;
+    for (int i = 0; i < n; i++) {
+        a[i] = i;
+        report(i);
+        sum += i;
+    }
+    return sum;
+}
+
+int main(int argc, char const *argv[]) {
+    int *a = malloc(10 * sizeof(int));
+    // In bounds, runs the unchecked version of the loop
+    int sum = fill(a, 10);
+    // One element past the end of the array with an additional argument, the
+    // instrumented version of the loop reports the violation
+    sum += fill(a, 9 + argc);
+    free(a);
+    return sum == 90 ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=example -mi-profile-checks -S | %filecheck %s
+
+; CHECK: @__mi_check_counts = internal global [2 x i64] zeroinitializer
+; CHECK: @__mi_check_ids = internal constant [2 x i64] [i64 {{[0-9]+}}, i64 {{[0-9]+}}]
+; CHECK: @__mi_check_profile_functions = internal constant [1 x { i8*, i64, i64 }]
+; CHECK: @llvm.global_ctors = {{.*}} @__mi_check_profile_setup
+
+; CHECK-LABEL: define i32 @test
+; CHECK: load i64, i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__mi_check_counts, i64 0, i64 0)
+; CHECK: load i32, i32* %p1
+; CHECK: load i64, i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__mi_check_counts, i64 0, i64 1)
+; CHECK: store i32 %x1, i32* %p2
+
+; CHECK-LABEL: define internal void @__mi_check_profile_setup
+; CHECK: call void @__mi_check_profile_register({{.*}}, i64 1)
+
+define i32 @test(i32* %p) {
+bb:
+  %p1 = getelementptr i32, i32* %p, i64 0
+  %x1 = load i32, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 1
+  store i32 %x1, i32* %p2
+  ret i32 %x1
+}
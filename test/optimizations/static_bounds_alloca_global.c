@@ -0,0 +1,22 @@
+// RUN: %clang -O0 -Xclang -disable-O0-optnone %s -c -S -emit-llvm -o %t
+// RUN: %opt -S -mem2reg -load %passlib -meminstrument -mi-config=splay -mi-opt-static-bounds -stats %t 2>&1 | %filecheck %s
+
+// CHECK: 3 {{.*}} discarded because they are statically in bounds
+
+// REQUIRES: asserts
+
+int global_arr[8];
+
+char local_access(int i) {
+    char buf[16];
+    // Constant index into a local array of known size, no check required
+    buf[3] = 'a';
+    // Unknown index, this one has to be checked
+    buf[i] = 'b';
+    return buf[0];
+}
+
+int global_access(void) {
+    // Constant index into a global array of known size, no check required
+    return global_arr[7];
+}
@@ -0,0 +1,33 @@
+; RUN: %opt %loadlibs -mi-config=example -meminstrument -mi-mode=setup -mi-label-accesses -S %s | %filecheck %s
+; RUN: sed -e 's/^;EXTRA //' %s | %opt %loadlibs -mi-config=example -meminstrument -mi-mode=setup -mi-label-accesses -S | %filecheck %s
+
+; The IDs only depend on the function name, the debug location, and the opcode
+; of the access, an additional load in front does not change them.
+
+; CHECK: load i32, i32* %p, align 4, !dbg !{{[0-9]+}}, !mi_access_id [[LOADID:![0-9]+]]
+; CHECK: store i32 %x, i32* %q, align 4, !dbg !{{[0-9]+}}, !mi_access_id [[STOREID:![0-9]+]]
+; CHECK-DAG: [[LOADID]] = !{!"8627374540744699223"}
+; CHECK-DAG: [[STOREID]] = !{!"4554628802395994018"}
+
+define void @f(i32* %p, i32* %q) !dbg !6 {
+entry:
+;EXTRA   %y = load i32, i32* %q, align 4, !dbg !11
+  %x = load i32, i32* %p, align 4, !dbg !9
+  store i32 %x, i32* %q, align 4, !dbg !10
+  ret void, !dbg !10
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "stable.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!6 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !7, scopeLine: 1, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !2)
+!7 = !DISubroutineType(types: !8)
+!8 = !{null}
+!9 = !DILocation(line: 3, column: 8, scope: !6)
+!10 = !DILocation(line: 4, column: 3, scope: !6)
+!11 = !DILocation(line: 2, column: 3, scope: !6)
@@ -0,0 +1,24 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=softbound -mi-sb-inline-checks -S | %filecheck %s
+
+; CHECK: %sb.base.load = call i8* @__softboundcets_load_base_shadow_stack(i32 0)
+; CHECK-NEXT: %sb.bound.load = call i8* @__softboundcets_load_bound_shadow_stack(i32 0)
+; CHECK: %p1 = getelementptr i32, i32* %p, i64 0
+; CHECK-NEXT: %p1_casted = bitcast i32* %p1 to i8*
+; CHECK-NEXT: [[END:%.*]] = getelementptr i8, i8* %p1_casted, i64 4
+; CHECK-NEXT: [[LOW:%.*]] = icmp ult i8* %p1_casted, %sb.base.load
+; CHECK-NEXT: [[UP:%.*]] = icmp ugt i8* [[END]], %sb.bound.load
+; CHECK-NEXT: [[VIO:%.*]] = or i1 [[LOW]], [[UP]]
+; CHECK-NEXT: br i1 [[VIO]], label %mi_fail, label %bb.mi_cont
+; CHECK-NOT: __softboundcets_spatial_dereference_check
+; CHECK: mi_fail:
+; CHECK-NEXT: call void @__mi_fail()
+; CHECK-NEXT: unreachable
+
+define i32 @test(i32* %p) {
+bb:
+  %p1 = getelementptr i32, i32* %p, i64 0
+  %x1 = load i32, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 1
+  %x2 = load i32, i32* %p2
+  ret i32 42
+}
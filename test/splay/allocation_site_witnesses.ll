@@ -0,0 +1,26 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-allocation-site-witnesses -S | %filecheck %s
+
+; CHECK-LABEL: define i8 @test
+; CHECK: %p = call i8* @malloc(i64 %n)
+; CHECK-NEXT: %mi_alloc_end = getelementptr i8, i8* %p, i64 %n
+; CHECK-NEXT: [[FAILED:%.*]] = icmp eq i8* %p, null
+; CHECK-NEXT: %mi_alloc_upper = select i1 [[FAILED]], i8* %p, i8* %mi_alloc_end
+; CHECK: [[END:%.*]] = getelementptr i8, i8* %q, i64 1
+; CHECK-NEXT: [[LOW:%.*]] = icmp ult i8* %q, %p
+; CHECK-NEXT: [[UP:%.*]] = icmp ugt i8* [[END]], %mi_alloc_upper
+; CHECK-NEXT: [[VIO:%.*]] = or i1 [[LOW]], [[UP]]
+; CHECK-NEXT: br i1 [[VIO]], label %mi_fail, label %bb.mi_cont
+; CHECK-NOT: call void @__splay_check_dereference
+; CHECK: mi_fail:
+; CHECK-NEXT: call void @__mi_fail()
+; CHECK-NEXT: unreachable
+
+declare i8* @malloc(i64)
+
+define i8 @test(i64 %n, i64 %i) {
+bb:
+  %p = call i8* @malloc(i64 %n)
+  %q = getelementptr i8, i8* %p, i64 %i
+  %x = load i8, i8* %q
+  ret i8 %x
+}
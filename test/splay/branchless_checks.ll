@@ -0,0 +1,32 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-static-witnesses -mi-branchless-checks -S | %filecheck %s
+
+; CHECK-LABEL: define i32 @test
+; CHECK: [[VIO:%.*]] = or i1
+; CHECK-NEXT: %mi_poisoned = select i1 [[VIO]], i32* inttoptr (i64 -9223372036854775808 to i32*), i32* %p, !unpredictable
+; CHECK-NEXT: %x = load i32, i32* %mi_poisoned
+; CHECK-NOT: br i1
+; CHECK-NOT: mi_fail
+
+; The stored pointer is only checked to be in bounds, the store itself must not
+; be redirected for that check.
+
+; CHECK-LABEL: define void @escape
+; CHECK: br i1 {{.*}}, label %mi_fail
+; CHECK: store i32* %p, i32**
+
+@arr = global [8 x i32] zeroinitializer
+@ptr = global i32* null
+
+define i32 @test(i64 %i) {
+bb:
+  %p = getelementptr [8 x i32], [8 x i32]* @arr, i64 0, i64 %i
+  %x = load i32, i32* %p
+  ret i32 %x
+}
+
+define void @escape(i64 %i) {
+bb:
+  %p = getelementptr [8 x i32], [8 x i32]* @arr, i64 0, i64 %i
+  store i32* %p, i32** @ptr
+  ret void
+}
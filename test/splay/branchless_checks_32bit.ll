@@ -0,0 +1,21 @@
+; RUN: %not %opt %loadlibs -meminstrument %s -mi-config=splay -mi-static-witnesses -mi-branchless-checks -S 2>&1 | %filecheck %s --check-prefix=DEFAULT
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-static-witnesses -mi-branchless-checks -mi-branchless-guard-address=0xfffff000 -S | %filecheck %s
+
+; The default guard address does not fit into a 32-bit pointer, truncating it
+; would yield null and the check would be folded away.
+; DEFAULT: The guard address 0x8000000000000000 of -mi-branchless-checks is not a non-null 32-bit pointer
+
+; CHECK-LABEL: define i32 @test
+; CHECK: %mi_poisoned = select i1 {{.*}}, i32* inttoptr (i32 -4096 to i32*), i32* %p, !unpredictable
+; CHECK-NEXT: %x = load i32, i32* %mi_poisoned
+
+target datalayout = "e-m:e-p:32:32-i64:64-n8:16:32-S128"
+
+@arr = global [8 x i32] zeroinitializer
+
+define i32 @test(i32 %i) {
+bb:
+  %p = getelementptr [8 x i32], [8 x i32]* @arr, i32 0, i32 %i
+  %x = load i32, i32* %p
+  ret i32 %x
+}
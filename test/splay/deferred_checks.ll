@@ -0,0 +1,62 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-static-witnesses -mi-deferred-checks -S | %filecheck %s
+; RUN: %not %opt %loadlibs -meminstrument %s -mi-config=splay -mi-static-witnesses -mi-deferred-checks -mi-sample-checks=8 -S 2>&1 | %filecheck %s --check-prefix=SAMPLE
+
+; CHECK-LABEL: define i32 @test
+; CHECK-NOT: br i1
+; CHECK: %x = load i32, i32* %p
+; CHECK-NOT: br i1
+; CHECK: %y = load i32, i32* %q
+; CHECK: [[VIO:%.*]] = or i1
+; CHECK-NEXT: br i1 [[VIO]], label %mi_fail, label %bb.mi_cont
+; CHECK: bb.mi_cont:
+; CHECK-NEXT: call void @foo(i32 %s)
+; CHECK-NOT: br i1
+; CHECK: ret i32 %s
+
+; A checked store may write anywhere if it is out of bounds, so its failure is
+; reported before it even if it targets a local.
+; CHECK-LABEL: define void @store_local
+; CHECK: br i1 {{.*}}, label %mi_fail, label %bb.mi_cont
+; CHECK: bb.mi_cont:
+; CHECK-NEXT: store i32 1, i32* %p
+
+; A volatile load might be observable, the failure has to be reported before it.
+; CHECK-LABEL: define i32 @volatile_read
+; CHECK: %x = load i32, i32* %p
+; CHECK: br i1 {{.*}}, label %mi_fail, label %bb.mi_cont
+; CHECK: bb.mi_cont:
+; CHECK-NEXT: %v = load volatile i32, i32* %m
+
+; SAMPLE: Deferred checks cannot be combined with sampled or patchable checks.
+
+declare void @foo(i32)
+
+@arr = global [8 x i32] zeroinitializer
+
+define i32 @test(i64 %i, i64 %j) {
+bb:
+  %p = getelementptr [8 x i32], [8 x i32]* @arr, i64 0, i64 %i
+  %x = load i32, i32* %p
+  %q = getelementptr [8 x i32], [8 x i32]* @arr, i64 0, i64 %j
+  %y = load i32, i32* %q
+  %s = add i32 %x, %y
+  call void @foo(i32 %s)
+  ret i32 %s
+}
+
+define void @store_local(i64 %i) {
+bb:
+  %a = alloca [8 x i32]
+  %p = getelementptr [8 x i32], [8 x i32]* %a, i64 0, i64 %i
+  store i32 1, i32* %p
+  ret void
+}
+
+define i32 @volatile_read(i64 %i, i32* %m) {
+bb:
+  %p = getelementptr [8 x i32], [8 x i32]* @arr, i64 0, i64 %i
+  %x = load i32, i32* %p
+  %v = load volatile i32, i32* %m
+  %s = add i32 %x, %v
+  ret i32 %s
+}
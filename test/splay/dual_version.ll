@@ -0,0 +1,31 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-dual-version -S | %filecheck %s
+; RUN: %not %opt %loadlibs -meminstrument %s -mi-config=softbound -mi-dual-version -S 2>&1 | %filecheck %s --check-prefix=SB
+
+; CHECK: @__mi_checks_enabled = weak global i8 1
+; CHECK: @llvm.global_ctors = {{.*}} @__mi_dual_version_setup
+
+define i32 @test(i32* %p) {
+bb:
+  %x = load i32, i32* %p
+  ret i32 %x
+}
+
+; CHECK-LABEL: define i32 @test(i32* %p)
+; CHECK: %mi_checks_enabled = load atomic i8, i8* @__mi_checks_enabled monotonic
+; CHECK: br i1 {{.*}}, label %mi_checked, label %mi_unchecked
+; CHECK: mi_checked:
+; CHECK: call {{.*}} @__splay_check
+; CHECK: %x = load i32, i32* %p
+; CHECK: mi_unchecked:
+; CHECK-NEXT: [[RES:%.*]] = tail call i32 @test.mi_unchecked(i32* %p)
+; CHECK-NEXT: ret i32 [[RES]]
+
+; CHECK-LABEL: define internal i32 @test.mi_unchecked(i32* %p)
+; CHECK-NOT: __splay_check
+; CHECK: ret i32
+
+; CHECK-LABEL: define internal void @__mi_dual_version_setup
+; CHECK: call i8* @getenv
+; CHECK: store i8 0, i8* @__mi_checks_enabled
+
+; SB: Dual version functions are only supported
@@ -0,0 +1,16 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -S | %filecheck %s
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-verbose -S | %filecheck %s --check-prefix=VERBOSE
+
+; CHECK: declare {{.*}}@__splay_check_dereference({{.*}}) [[CHECK_ATTRS:#[0-9]+]]
+; CHECK: declare {{.*}}@__splay_get_lower_as_ptr({{.*}}) [[LOOKUP_ATTRS:#[0-9]+]]
+; CHECK: attributes [[CHECK_ATTRS]] = { inaccessiblememonly nounwind }
+; CHECK: attributes [[LOOKUP_ATTRS]] = { inaccessiblememonly nounwind willreturn }
+
+; VERBOSE: declare {{.*}}@__splay_check_dereference_named({{.*}}) [[CHECK_ATTRS:#[0-9]+]]
+; VERBOSE: attributes [[CHECK_ATTRS]] = { inaccessiblemem_or_argmemonly nounwind }
+
+define i32 @test(i32* %p) {
+bb:
+  %x = load i32, i32* %p
+  ret i32 %x
+}
@@ -0,0 +1,22 @@
+; RUN: %opt %loadlibs -meminstrument %s -mi-config=splay -mi-static-witnesses -S | %filecheck %s
+
+; CHECK-LABEL: define i32 @test
+; CHECK: %p_casted = bitcast i32* %p to i8*
+; CHECK-NEXT: [[END:%.*]] = getelementptr i8, i8* %p_casted, i64 4
+; CHECK-NEXT: [[LOW:%.*]] = icmp ult i8* %p_casted, {{.*}}@arr
+; CHECK-NEXT: [[UP:%.*]] = icmp ugt i8* [[END]], {{.*}}@arr{{.*}}32
+; CHECK-NEXT: [[VIO:%.*]] = or i1 [[LOW]], [[UP]]
+; CHECK-NEXT: br i1 [[VIO]], label %mi_fail, label %bb.mi_cont
+; CHECK-NOT: call void @__splay_check_dereference
+; CHECK: mi_fail:
+; CHECK-NEXT: call void @__mi_fail()
+; CHECK-NEXT: unreachable
+
+@arr = global [8 x i32] zeroinitializer
+
+define i32 @test(i64 %i) {
+bb:
+  %p = getelementptr [8 x i32], [8 x i32]* @arr, i64 0, i64 %i
+  %x = load i32, i32* %p
+  ret i32 %x
+}